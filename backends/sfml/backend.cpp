@@ -1,23 +1,232 @@
 #include <backend.hpp>
 #include <SFML/OpenGL.hpp>
+#include <algorithm>
 #include <cmath>
 
 namespace Guider
 {
 	void SfmlCanvas::drawRectangle(const Rect& rect, const Color& color)
 	{
-		rectangle.setSize(sf::Vector2f(rect.width, rect.height));
-		rectangle.setPosition(rect.left, rect.top);
-		rectangle.setFillColor(sf::Color(color.r, color.g, color.b, color.a));
-		target.draw(rectangle);
+		queue(rect, sf::Color(color.r, color.g, color.b, color.a), false);
+	}
+
+	void SfmlCanvas::drawRectangle(const Rect& rect, const sf::Color& color)
+	{
+		queue(rect, color, false);
+	}
+
+	void SfmlCanvas::drawMaskRectangle(const Rect& rect)
+	{
+		queue(rect, sf::Color::Transparent, true);
+	}
+
+	void SfmlCanvas::drawNative(const sf::Drawable& drawable, const sf::RenderStates& states)
+	{
+		flush();
+		applyView();
+		if (masked)
+		{
+			for (const Rect& m : maskRects)
+			{
+				Rect r = clipped ? m.limit(clip) : m;
+				if (r.width <= 0 || r.height <= 0)
+					continue;
+				setScissor(r);
+				target.draw(drawable, states);
+				drawCalls++;
+			}
+		}
+		else
+		{
+			applyClip();
+			target.draw(drawable, states);
+			drawCalls++;
+		}
+	}
+
+	void SfmlCanvas::setOrigin(const sf::Vector2f& o)
+	{
+		origin = o;
+	}
+
+	void SfmlCanvas::setClip(const Rect& rect)
+	{
+		clip = rect;
+		clipped = true;
+	}
+
+	void SfmlCanvas::resetClip()
+	{
+		scissorKnown = false;
+		glDisable(GL_SCISSOR_TEST);
+		scissorEnabled = false;
+	}
+
+	void SfmlCanvas::setMaskRects(const std::vector<Rect>& rects)
+	{
+		flush();
+		maskRects = rects;
+		masked = true;
+	}
+
+	void SfmlCanvas::clearMaskRects()
+	{
+		flush();
+		maskRects.clear();
+		masked = false;
+	}
+
+	void SfmlCanvas::flush()
+	{
+		if (batch.getVertexCount() == 0)
+			return;
+
+		//vertices are already clipped and in target coordinates
+		disableScissor();
+		if (!viewApplied)
+			applyView();
+
+		sf::RenderStates states;
+		states.transform.translate(-viewOrigin);
+		if (batchMask)
+			glColorMask(false, false, false, false);
+		target.draw(batch, states);
+		if (batchMask)
+			glColorMask(true, true, true, true);
+
+		batch.clear();
+		drawCalls++;
+	}
+
+	size_t SfmlCanvas::getDrawCalls() const noexcept
+	{
+		return drawCalls;
+	}
+
+	void SfmlCanvas::resetDrawCalls()
+	{
+		drawCalls = 0;
+	}
+
+	void SfmlCanvas::queue(const Rect& rect, const sf::Color& color, bool mask)
+	{
+		Rect r(rect.left + origin.x, rect.top + origin.y, rect.width, rect.height);
+		if (clipped)
+			r = r.limit(clip);
+		if (r.width <= 0 || r.height <= 0)
+			return;
+
+		if (mask != batchMask)
+		{
+			flush();
+			batchMask = mask;
+		}
+
+		if (masked)
+		{
+			for (const Rect& m : maskRects)
+			{
+				Rect piece = r.limit(m);
+				if (piece.width > 0 && piece.height > 0)
+					appendQuad(piece, color);
+			}
+		}
+		else
+		{
+			appendQuad(r, color);
+		}
+	}
+
+	void SfmlCanvas::appendQuad(const Rect& r, const sf::Color& color)
+	{
+		sf::Vector2f lt(r.left, r.top);
+		sf::Vector2f rt(r.left + r.width, r.top);
+		sf::Vector2f lb(r.left, r.top + r.height);
+		sf::Vector2f rb(r.left + r.width, r.top + r.height);
+		batch.append(sf::Vertex(lt, color));
+		batch.append(sf::Vertex(rt, color));
+		batch.append(sf::Vertex(lb, color));
+		batch.append(sf::Vertex(lb, color));
+		batch.append(sf::Vertex(rt, color));
+		batch.append(sf::Vertex(rb, color));
+	}
+
+	void SfmlCanvas::applyView()
+	{
+		sf::Vector2u size = target.getSize();
+		if (viewApplied && viewOrigin == origin && viewSize == size)
+			return;
+
+		sf::View view;
+		view.setCenter(-origin+sf::Vector2f(
+			static_cast<float>(size.x),
+			static_cast<float>(size.y)
+		)*0.5f);
+		view.setViewport(sf::FloatRect(0, 0, 1, 1));
+		
+		view.setSize(sf::Vector2f(
+			static_cast<float>(size.x),
+			static_cast<float>(size.y)
+		));
+		target.setView(view);
+
+		viewOrigin = origin;
+		viewSize = size;
+		viewApplied = true;
+	}
+
+	void SfmlCanvas::applyClip()
+	{
+		if (clipped)
+			setScissor(clip);
+		else
+			disableScissor();
+	}
+
+	void SfmlCanvas::setScissor(const Rect& rect)
+	{
+		if (!scissorEnabled)
+		{
+			glEnable(GL_SCISSOR_TEST);
+			scissorEnabled = true;
+		}
+		if (scissorKnown && scissor == rect)
+			return;
+		scissor = rect;
+		scissorKnown = true;
+
+		sf::Vector2u size = target.getSize();
+
+		GLint left = static_cast<GLint>(rect.left);
+		GLint top = static_cast<GLint>(round(rect.top));
+
+		GLint right = static_cast<GLint>(round(rect.left + rect.width));
+		GLint bottom = static_cast<GLint>(rect.top + rect.height);
+
+		glScissor(
+			left,
+			static_cast<GLint>(size.y) - bottom,
+			right - left,
+			bottom - top
+		);
+	}
+
+	void SfmlCanvas::disableScissor()
+	{
+		if (scissorEnabled)
+		{
+			glDisable(GL_SCISSOR_TEST);
+			scissorEnabled = false;
+		}
 	}
 
 	namespace SFMLResources
 	{
 		void ImageResource::draw(Canvas& canvas, const Rect& bounds)
 		{
+			sprite.setPosition(bounds.left, bounds.top);
 			sprite.setScale(bounds.width/width,bounds.height/height);
-			canvas.as<SfmlCanvas>().getTarget().draw(sprite);
+			canvas.as<SfmlCanvas>().drawNative(sprite);
 		}
 		ImageResource::ImageResource(const std::string& path)
 		{
@@ -29,32 +238,38 @@ namespace Guider
 		}
 		Guider::Resources::ImageResource& ImageCanvas::getImage()
 		{
+			//pending rectangles have to reach the texture before it is used
+			flush();
+			texture.display();
 			return imageResourceWrapper;
 		}
 		void ImageCanvas::drawRectangle(const Rect& rect, const Color& color)
 		{
 			SfmlCanvas::drawRectangle(rect, color);
 		}
+		void ImageCanvas::clear()
+		{
+			flush();
+			texture.clear(sf::Color::Transparent);
+		}
 		void ConstImageResource::draw(Canvas& canvas, const Rect& rect)
 		{
 			sf::Vector2u size = texture.getSize();
 			sprite.setTexture(texture,true);
+			sprite.setPosition(rect.left, rect.top);
 			sprite.setScale(rect.width / size.x, rect.height / size.y);
+			canvas.as<SfmlCanvas>().drawNative(sprite);
 		}
 		void RectangleShape::draw(Canvas& canvas, const Rect& bounds)
 		{
-			bool resetSize = false;
-			rectangle.setPosition(bounds.left, bounds.top);
-			if (rectangle.getSize() == sf::Vector2f(0, 0))
-			{
-				resetSize = true;
-				rectangle.setSize(sf::Vector2f(bounds.width,bounds.height));
-			}
-			canvas.as<SfmlCanvas>().getTarget().draw(rectangle);
-			if (resetSize)
+			Rect rect = bounds;
+			sf::Vector2f size = rectangle.getSize();
+			if (size != sf::Vector2f(0, 0))
 			{
-				rectangle.setSize(sf::Vector2f(0,0));
+				rect.width = size.x;
+				rect.height = size.y;
 			}
+			canvas.as<SfmlCanvas>().drawRectangle(rect, rectangle.getFillColor());
 		}
 		void RectangleShape::setSize(const Vec2& size)
 		{
@@ -72,22 +287,107 @@ namespace Guider
 		float FontResource::getLineHeight(float textSize) const
 		{
 			std::pair<unsigned, float> p = unpackTextSize(textSize);
+			std::lock_guard<std::mutex> lock(mutex);
 			return font.getLineSpacing(p.first) * p.second;
 		}
 		float FontResource::getLineWidth(float textSize, const std::string& text) const
 		{
+			LineWidthKey key{ text, textSize };
+			std::lock_guard<std::mutex> lock(mutex);
+			auto it = lineWidthIndex.find(key);
+			if (it != lineWidthIndex.end())
+			{
+				lineWidths.splice(lineWidths.begin(), lineWidths, it->second);
+				return it->second->second;
+			}
+
 			std::pair<unsigned, float> p = unpackTextSize(textSize);
-			sf::Text t;
-			t.setCharacterSize(p.first);
-			t.setString(text);
-			t.setFont(font);
-			return (t.getLocalBounds().width+2) * p.second;
+			float width = (measureLine(p.first, text) + 2) * p.second;
+
+			if (lineWidths.size() >= lineWidthCacheSize)
+			{
+				lineWidthIndex.erase(lineWidths.back().first);
+				lineWidths.pop_back();
+			}
+			lineWidths.emplace_front(std::move(key), width);
+			lineWidthIndex.emplace(lineWidths.front().first, lineWidths.begin());
+			return width;
+		}
+		FontResource::SizeMetrics& FontResource::getSizeMetrics(unsigned characterSize) const
+		{
+			auto it = metrics.find(characterSize);
+			if (it != metrics.end())
+				return it->second;
+			SizeMetrics& m = metrics[characterSize];
+			m.whitespace = font.getGlyph(U' ', characterSize, false).advance;
+			return m;
+		}
+		const FontResource::GlyphMetrics& FontResource::getGlyphMetrics(SizeMetrics& m, uint32_t c, unsigned characterSize) const
+		{
+			auto it = m.glyphs.find(c);
+			if (it != m.glyphs.end())
+				return it->second;
+			const sf::Glyph& glyph = font.getGlyph(c, characterSize, false);
+			GlyphMetrics& g = m.glyphs[c];
+			g.advance = glyph.advance;
+			g.left = glyph.bounds.left;
+			g.right = glyph.bounds.left + glyph.bounds.width;
+			return g;
+		}
+		float FontResource::getKerning(SizeMetrics& m, uint32_t first, uint32_t second, unsigned characterSize) const
+		{
+			uint64_t key = (static_cast<uint64_t>(first) << 32) | second;
+			auto it = m.kerning.find(key);
+			if (it != m.kerning.end())
+				return it->second;
+			float kerning = font.getKerning(first, second, characterSize);
+			m.kerning.emplace(key, kerning);
+			return kerning;
+		}
+		float FontResource::measureLine(unsigned characterSize, const std::string& text) const
+		{
+			if (text.empty())
+				return 0;
+
+			SizeMetrics& m = getSizeMetrics(characterSize);
+			float x = 0;
+			float minX = static_cast<float>(characterSize), maxX = 0;
+			uint32_t prev = 0;
+			for (char ch : text)
+			{
+				//sf::Text converts std::string byte by byte
+				uint32_t c = static_cast<unsigned char>(ch);
+				if (c == '\r')
+					continue;
+				if (prev != 0)
+					x += getKerning(m, prev, c, characterSize);
+				prev = c;
+
+				if (c == ' ' || c == '\t' || c == '\n')
+				{
+					minX = std::min(minX, x);
+					if (c == ' ')
+						x += m.whitespace;
+					else if (c == '\t')
+						x += m.whitespace * 4;
+					else
+						x = 0;
+					maxX = std::max(maxX, x);
+					continue;
+				}
+
+				const GlyphMetrics& g = getGlyphMetrics(m, c, characterSize);
+				minX = std::min(minX, x + g.left);
+				maxX = std::max(maxX, x + g.right);
+				x += g.advance;
+			}
+			return std::max(0.f, maxX - minX);
 		}
 		void TextResource::draw(Canvas& canvas, const Rect& bounds)
 		{
 			Rect adjustedRect = getAdjustedRect(bounds);
 			text.setPosition(adjustedRect.left, adjustedRect.top);
-			canvas.as<SfmlCanvas>().getTarget().draw(text);
+			canvas.as<SfmlCanvas>().drawNative(text);
 		}
 		void TextResource::setText(const std::string& text)
 		{
@@ -138,7 +438,7 @@ namespace Guider
 		case sf::Event::MouseEntered:
 		case sf::Event::MouseMoved:
 		{
-			engine.handleEvent(
+			engine.postEvent(
 				Guider::Event::createMouseEvent(
 					Guider::Event::MouseEvent::Subtype::Moved,
 					static_cast<float>(event.mouseMove.x),
@@ -150,7 +450,7 @@ namespace Guider
 		}
 		case sf::Event::MouseButtonPressed:
 		{
-			engine.handleEvent(
+			engine.postEvent(
 				Guider::Event::createMouseEvent(
 					Guider::Event::MouseEvent::Subtype::ButtonDown,
 					static_cast<float>(event.mouseButton.x),
@@ -162,7 +462,7 @@ namespace Guider
 		}
 		case sf::Event::MouseButtonReleased:
 		{
-			engine.handleEvent(
+			engine.postEvent(
 				Guider::Event::createMouseEvent(
 					Guider::Event::MouseEvent::Subtype::ButtonUp,
 					static_cast<float>(event.mouseButton.x),
@@ -190,60 +490,64 @@ namespace Guider
 
 	void SfmlBackend::setDrawOrigin(float x, float y)
 	{
-		sf::Vector2u size = canvas->getTarget().getSize();
-		origin = sf::Vector2f(x, y);
-		view.setCenter(-origin+sf::Vector2f(
-			static_cast<float>(size.x),
-			static_cast<float>(size.y)
-		)*0.5f);
-		view.setViewport(sf::FloatRect(0, 0, 1, 1));
-		
-		view.setSize(sf::Vector2f(
-			static_cast<float>(size.x),
-			static_cast<float>(size.y)
-		));
-		canvas->getTarget().setView(view);
+		//view is applied lazily by canvas
+		current->setOrigin(sf::Vector2f(x, y));
 	}
 
 	void SfmlBackend::clearMask()
 	{
+		canvas->flush();
 		canvas->getTarget().pushGLStates();
 
 		glEnable(GL_STENCIL_TEST);
+		stencilActive = true;
 		glClearStencil(0);
 		glClear(GL_STENCIL_BUFFER_BIT);
 	}
 	void SfmlBackend::setupMask()
 	{
+		canvas->flush();
 		glStencilFunc(GL_ALWAYS, 1, 0xFF);
 		glStencilOp(GL_REPLACE, GL_REPLACE, GL_REPLACE);
 		glStencilMask(0xFF);
 	}
 	void SfmlBackend::useMask()
 	{
+		canvas->flush();
 		glStencilFunc(GL_EQUAL, 1, 0xFF);
 		glStencilMask(0x00);
 	}
 	void SfmlBackend::disableMask()
 	{
+		canvas->flush();
 		canvas->getTarget().popGLStates();
+		stencilActive = false;
+		canvas->resetClip();
 	}
 	void SfmlBackend::pushMaskLayer()
 	{
+		canvas->flush();
 		maskLevel++;
 		glStencilFunc(GL_GEQUAL, maskLevel, 0xFF);
 	}
 	void SfmlBackend::popMaskLayer()
 	{
+		canvas->flush();
 		maskLevel--;
 		glStencilFunc(GL_GEQUAL, maskLevel, 0xFF);
 	}
 	void SfmlBackend::addToMask(const Rect& rect)
 	{
-		glColorMask(false, false, false, false);
-		maskRect.setSize(Vec2(0,0));
-		maskRect.draw(*canvas,Rect(rect.left, rect.top, rect.width, rect.height));
-		glColorMask(true, true, true, true);
+		canvas->drawMaskRectangle(rect);
+	}
+	void SfmlBackend::useMaskRects(const std::vector<Rect>& rects)
+	{
+		canvas->setMaskRects(rects);
+	}
+	void SfmlBackend::disableMaskRects()
+	{
+		canvas->clearMaskRects();
+		canvas->resetClip();
 	}
 
 	Vec2 SfmlBackend::getSize() const noexcept
@@ -256,23 +560,38 @@ namespace Guider
 		//sfml does not have api for resizing sf::RenderTarget
 	}
 
-	void SfmlBackend::setBounds(const Rect& rect)
+	size_t SfmlBackend::getDrawCalls() const noexcept
 	{
-		Vec2 size = getSize();
-		glEnable(GL_SCISSOR_TEST);
+		return canvas->getDrawCalls();
+	}
+	void SfmlBackend::resetDrawCalls()
+	{
+		canvas->resetDrawCalls();
+	}
 
-		GLint left = static_cast<GLint>(rect.left);
-		GLint top = static_cast<GLint>(round(rect.top));
+	void SfmlBackend::setBounds(const Rect& rect)
+	{
+		//scissor is applied lazily, batched rectangles are clipped on CPU
+		current->setClip(rect);
+	}
 
-		GLint right = static_cast<GLint>(round(rect.left + rect.width));
-		GLint bottom = static_cast<GLint>(rect.top + rect.height);
+	void SfmlBackend::setLayer(Resources::ImageCanvas* layer)
+	{
+		SfmlCanvas* next = canvas.get();
+		if (layer != nullptr)
+			next = static_cast<SFMLResources::ImageCanvas*>(layer);
+		if (next == current)
+			return;
 
-		glScissor(
-			left,
-			static_cast<GLint>(size.y) - bottom,
-			right - left,
-			bottom - top
-		);
+		current->flush();
+		//layer content must not be clipped by mask of the frame
+		if (stencilActive && current == canvas.get())
+			glDisable(GL_STENCIL_TEST);
+		current = next;
+		current->getTarget().setActive(true);
+		if (stencilActive && current == canvas.get())
+			glEnable(GL_STENCIL_TEST);
+		current->resetClip();
 	}
 
 	std::shared_ptr<Resources::RectangleShape> SfmlBackend::createRectangle(const Vec2& size, const Color& color)
@@ -317,7 +636,7 @@ namespace Guider
 	}
 	std::shared_ptr<Resources::ImageCanvas> SfmlBackend::createImage(const Vec2& size)
 	{
-		return std::make_shared<SFMLResources::ImageCanvas>();
+		return std::make_shared<SFMLResources::ImageCanvas>(static_cast<uint32_t>(std::ceil(size.x)), static_cast<uint32_t>(std::ceil(size.y)));
 	}
 	void SfmlBackend::deleteResource(Resources::Resource& resource) {}
 
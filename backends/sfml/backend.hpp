@@ -2,24 +2,94 @@
 
 #include <guider/base.hpp>
 #include <SFML/Graphics.hpp>
+#include <list>
+#include <mutex>
 #include <unordered_map>
 
 namespace Guider
 {
+	/// @brief Canvas drawing on SFML render target.
+	/// 
+	/// Solid color rectangles are clipped on CPU and batched into single vertex array,
+	/// which is flushed only when other drawing or GL state change requires it.
 	class SfmlCanvas : public Canvas
 	{
 	public:
+		/// @brief Returns render target.
+		/// 
+		/// @note Drawing directly on the target skips pending batch, use @ref drawNative instead.
 		inline sf::RenderTarget& getTarget()
 		{
 			return target;
 		}
 
 		virtual void drawRectangle(const Rect& rect, const Color& color) override;
-
-		SfmlCanvas(sf::RenderTarget& t) : target(t) {}
+		/// @brief Queues solid color rectangle.
+		/// @param rect Rect relative to current origin.
+		/// @param color Fill color.
+		void drawRectangle(const Rect& rect, const sf::Color& color);
+		/// @brief Queues rectangle that writes only to the stencil buffer.
+		/// @param rect Rect relative to current origin.
+		void drawMaskRectangle(const Rect& rect);
+		/// @brief Draws SFML drawable, pending batch is flushed and clipping applied first.
+		void drawNative(const sf::Drawable& drawable, const sf::RenderStates& states = sf::RenderStates::Default);
+
+		/// @brief Sets drawing origin.
+		/// 
+		/// View of the target is updated only before native draw, when origin differs from applied one.
+		void setOrigin(const sf::Vector2f& origin);
+		/// @brief Sets clipping rect in target coordinates.
+		/// 
+		/// Scissor is updated only before native draw, when rect differs from applied one.
+		void setClip(const Rect& rect);
+		/// @brief Forgets applied scissor state.
+		/// 
+		/// Required after GL states are restored by SFML.
+		void resetClip();
+		/// @brief Limits drawing to given rects, in target coordinates.
+		/// 
+		/// Rectangles are split on CPU, native draws are issued once per rect with scissor.
+		void setMaskRects(const std::vector<Rect>& rects);
+		/// @brief Removes limit set by @ref setMaskRects.
+		void clearMaskRects();
+
+		/// @brief Draws pending batch.
+		/// 
+		/// Has to be called before changing GL state that batch depends on.
+		void flush();
+
+		/// @brief Returns number of draw calls issued since last @ref resetDrawCalls.
+		size_t getDrawCalls() const noexcept;
+		void resetDrawCalls();
+
+		SfmlCanvas(sf::RenderTarget& t) : target(t), batch(sf::Triangles), batchMask(false), viewApplied(false), clip(), clipped(false), scissor(), scissorEnabled(false), scissorKnown(false), masked(false), drawCalls(0) {}
 	private:
 		sf::RenderTarget& target;
-		sf::RectangleShape rectangle;
+		/// @brief Queued rectangles in target coordinates, two triangles each.
+		sf::VertexArray batch;
+		/// @brief True if queued rectangles are stencil only.
+		bool batchMask;
+		sf::Vector2f origin;
+		/// @brief Origin and target size of view set on target.
+		sf::Vector2f viewOrigin;
+		sf::Vector2u viewSize;
+		bool viewApplied;
+		Rect clip;
+		bool clipped;
+		/// @brief Last rect passed to glScissor, valid when scissorKnown.
+		Rect scissor;
+		bool scissorEnabled;
+		bool scissorKnown;
+		std::vector<Rect> maskRects;
+		bool masked;
+		size_t drawCalls;
+
+		void queue(const Rect& rect, const sf::Color& color, bool mask);
+		void appendQuad(const Rect& rect, const sf::Color& color);
+		void applyView();
+		void applyClip();
+		void setScissor(const Rect& rect);
+		void disableScissor();
 	};
 
 
@@ -54,6 +124,7 @@ namespace Guider
 			virtual Guider::Resources::ImageResource& getImage() override;
 
 			virtual void drawRectangle(const Rect& rect, const Color& color) override;
+			virtual void clear() override;
 
 			ImageCanvas() : SfmlCanvas(texture), imageResourceWrapper(texture.getTexture()) {}
 			ImageCanvas(uint32_t width,uint32_t height) : SfmlCanvas(texture), imageResourceWrapper(texture.getTexture())
@@ -61,8 +132,8 @@ namespace Guider
 				texture.create(width, height, sf::ContextSettings(0, 8));
 			}
 		private:
-			ConstImageResource imageResourceWrapper;
 			sf::RenderTexture texture;
+			ConstImageResource imageResourceWrapper;
 
 			// Odziedziczono za porednictwem elementu ImageCanvas
 		};
@@ -103,10 +174,62 @@ namespace Guider
 				return name;
 			}
 
+			/// @brief Maximal number of remembered line widths.
+			static constexpr size_t lineWidthCacheSize = 256;
+
 			FontResource(const sf::Font& f, const std::string n) : font(f), name(n) {}
 		private:
+			/// @brief Horizontal metrics of single glyph.
+			class GlyphMetrics
+			{
+			public:
+				float advance, left, right;
+			};
+			/// @brief Glyph metrics and kerning of single character size.
+			class SizeMetrics
+			{
+			public:
+				float whitespace;
+				std::unordered_map<uint32_t, GlyphMetrics> glyphs;
+				/// @brief Kerning indexed by both characters packed together.
+				std::unordered_map<uint64_t, float> kerning;
+			};
+			class LineWidthKey
+			{
+			public:
+				std::string text;
+				float textSize;
+
+				bool operator==(const LineWidthKey& other) const noexcept
+				{
+					return textSize == other.textSize && text == other.text;
+				}
+			};
+			class LineWidthKeyHash
+			{
+			public:
+				size_t operator()(const LineWidthKey& key) const noexcept
+				{
+					return std::hash<std::string>()(key.text) ^ (std::hash<float>()(key.textSize) * 31);
+				}
+			};
+			using LineWidthList = std::list<std::pair<LineWidthKey, float>>;
+
 			sf::Font font;
 			std::string name;
+
+			/// @brief Guards caches and glyph loading, text may be measured concurrently.
+			mutable std::mutex mutex;
+			mutable std::unordered_map<unsigned, SizeMetrics> metrics;
+			/// @brief Recently measured lines, most recent first.
+			mutable LineWidthList lineWidths;
+			mutable std::unordered_map<LineWidthKey, LineWidthList::iterator, LineWidthKeyHash> lineWidthIndex;
+
+			SizeMetrics& getSizeMetrics(unsigned characterSize) const;
+			const GlyphMetrics& getGlyphMetrics(SizeMetrics& m, uint32_t c, unsigned characterSize) const;
+			float getKerning(SizeMetrics& m, uint32_t first, uint32_t second, unsigned characterSize) const;
+			/// @brief Computes width of text bounds the same way as sf::Text, from cached metrics.
+			float measureLine(unsigned characterSize, const std::string& text) const;
 		};
 
 		class TextResource : public Guider::Resources::TextResource
@@ -132,6 +255,10 @@ namespace Guider
 	class SfmlBackend : public Backend
 	{
 	public:
+		/// @brief Translates SFML event and queues it in engine.
+		///
+		/// Queued events are delivered with next @ref Engine::update.
+		/// @return True if event was queued.
 		static bool handleEvent(Engine& engine, const sf::Event& event);
 
 		virtual void setDrawOrigin(float x, float y) override;
@@ -143,13 +270,21 @@ namespace Guider
 		virtual void pushMaskLayer() override;
 		virtual void popMaskLayer() override;
 		virtual void addToMask(const Rect& rect) override;
+		virtual void useMaskRects(const std::vector<Rect>& rects) override;
+		virtual void disableMaskRects() override;
 
 		virtual std::shared_ptr<Canvas> getCanvas() override;
 		virtual void setBounds(const Rect& rect) override;
+		/// @brief Redirects drawing to layer texture, stencil mask of the main target is suspended meanwhile.
+		virtual void setLayer(Resources::ImageCanvas* layer) override;
 
 		virtual Vec2 getSize() const noexcept override;
 		virtual void setSize(const Vec2& size) override;
 
+		/// @brief Returns number of draw calls issued on main canvas since last @ref resetDrawCalls.
+		size_t getDrawCalls() const noexcept;
+		void resetDrawCalls();
+
 		virtual std::shared_ptr<Resources::RectangleShape> createRectangle(const Vec2& size, const Color& color) override;
 		virtual std::shared_ptr<Resources::TextResource> createText(const std::string& text, const Resources::FontResource& font, float size, const Color& color) override;
 		virtual std::shared_ptr<Resources::FontResource> getFontByName(const std::string& name) override;
@@ -158,15 +293,14 @@ namespace Guider
 		virtual std::shared_ptr<Resources::ImageCanvas> createImage(const Vec2& size) override;
 		virtual void deleteResource(Resources::Resource& resource) override;
 
-		SfmlBackend(sf::RenderTarget& t) : Backend(), canvas(std::make_shared<SfmlCanvas>(t)), origin(0, 0), maskLevel(1) {}
+		SfmlBackend(sf::RenderTarget& t) : Backend(), canvas(std::make_shared<SfmlCanvas>(t)), current(canvas.get()), maskLevel(1), stencilActive(false) {}
 	private:
-		sf::View view;
-
 		std::shared_ptr<SfmlCanvas> canvas;
+		/// @brief Canvas that origin and bounds changes go to, main canvas or current layer.
+		SfmlCanvas* current;
 
-		sf::Vector2f origin;
-		SFMLResources::RectangleShape maskRect;
 		unsigned char maskLevel;
+		bool stencilActive;
 		std::unordered_map<std::string, std::shared_ptr<SFMLResources::FontResource>> fonts;
 	};
 }
\ No newline at end of file
@@ -10,7 +10,9 @@
 #include <stdexcept>
 #include <memory>
 #include <functional>
+#include <type_traits>
 #include <algorithm>
+#include <atomic>
 
 
 namespace Guider
@@ -78,6 +80,74 @@ namespace Guider
 		Rect(const Rect&) = default;
 		Rect(Rect&&) noexcept = default;
 	};
+	/// @brief Area made of rects.
+	///
+	/// Stored as horizontal bands, each band has sorted and disjoint spans.
+	/// Vertically adjacent bands with equal spans are merged,
+	/// so equal areas always have equal representation.
+	class Region
+	{
+	public:
+		Region& unite(const Rect& rect);
+		Region& unite(const Region& region);
+		Region& intersect(const Rect& rect);
+		Region& intersect(const Region& region);
+		Region& subtract(const Rect& rect);
+		Region& subtract(const Region& region);
+
+		/// @brief Removes whole area.
+		void clear();
+
+		bool isEmpty() const noexcept;
+		/// @brief Checks if region contains point.
+		bool contains(const Vec2& point) const noexcept;
+		/// @brief Checks if region overlaps rect.
+		bool intersects(const Rect& rect) const noexcept;
+		/// @brief Returns smallest rect containing whole region.
+		Rect getBounds() const noexcept;
+		/// @brief Returns disjoint rects covering region, ordered top to bottom, left to right.
+		std::vector<Rect> getRects() const;
+		/// @brief Returns number of rects returned by @ref getRects.
+		size_t getRectCount() const noexcept;
+
+		bool operator == (const Region& region) const noexcept;
+		bool operator != (const Region& region) const noexcept;
+
+		Region();
+		Region(const Rect& rect);
+		/// @brief Creates union of rects.
+		Region(const std::vector<Rect>& rects);
+		Region(const Region&) = default;
+		Region(Region&&) noexcept = default;
+		Region& operator = (const Region&) = default;
+		Region& operator = (Region&&) noexcept = default;
+	private:
+		struct Span
+		{
+			float left, right;
+		};
+		struct Band
+		{
+			float top, bottom;
+			/// @brief Range of spans.
+			size_t begin, end;
+		};
+
+		enum class Operation
+		{
+			Union,
+			Intersection,
+			Difference
+		};
+
+		std::vector<Band> bands;
+		std::vector<Span> spans;
+
+		static Region combine(const Region& a, const Region& b, Operation op);
+		/// @brief Builds region from rects in single sweep, region must be empty.
+		void build(const std::vector<Rect>& rects);
+		void appendBand(float top, float bottom, const std::vector<Span>& s);
+	};
 	/// @brief Basic color class.
 	class Color
 	{
@@ -168,14 +238,23 @@ namespace Guider
 		/// @brief Draws drawable within give bounds.
 		/// @param drawable Drawanble.
 		/// @param rect Bounds.
-		void draw(Resources::Drawable& drawable, const Rect& rect);
+		virtual void draw(Resources::Drawable& drawable, const Rect& rect);
+
+		/// @brief Returns canvas that actually renders calls.
+		/// 
+		/// Canvases forwarding calls to other canvas return the final one.
+		virtual Canvas& getRenderingCanvas();
 
 		/// @brief Cast from canvas interface to implementation.
+		/// 
+		/// Casts @ref getRenderingCanvas, so backend resources can be drawn on forwarding canvases.
 		/// @tparam T implementation type.
 		template<typename T>T& as()
 		{
-			return static_cast<T&>(*this);
+			return static_cast<T&>(getRenderingCanvas());
 		}
+
+		virtual ~Canvas() = default;
 	};
 
 	namespace Resources
@@ -222,6 +301,10 @@ namespace Guider
 		{
 		public:
 			virtual ImageResource& getImage() = 0;
+			/// @brief Clears whole image to transparent.
+			/// 
+			/// Default implementation throws std::logic_error, backends supporting layers have to override it.
+			virtual void clear();
 		};
 
 		class RectangleShape : public Drawable
@@ -276,11 +359,67 @@ namespace Guider
 		};
 	}
 
+	/// @brief Canvas recording drawing calls while forwarding them to another canvas.
+	/// 
+	/// Calls are recorded relative to current draw offset, so recording can be replayed at any position.
+	/// Drawables are referenced, not copied, and have to outlive the recording.
+	class DisplayList : public Canvas
+	{
+	public:
+		virtual void drawRectangle(const Rect& rect, const Color& color) override;
+		virtual void draw(Resources::Drawable& drawable, const Rect& rect) override;
+		/// @brief Returns target of current recording.
+		virtual Canvas& getRenderingCanvas() override;
+
+		/// @brief Starts recording, previous recording is discarded.
+		/// @param target Canvas calls are forwarded to.
+		void begin(Canvas& target);
+		/// @brief Finishes recording.
+		void end();
+		/// @brief Issues recorded calls on canvas.
+		void replay(Canvas& canvas) const;
+		/// @brief Discards recording.
+		void clear();
+
+		/// @brief Returns true when finished recording is available.
+		bool isRecorded() const noexcept;
+		/// @brief Returns number of recorded calls.
+		size_t getCommandCount() const noexcept;
+
+		DisplayList();
+	private:
+		/// @brief Single recorded call, rectangle when drawable is null.
+		class Command
+		{
+		public:
+			Resources::Drawable* drawable;
+			Rect rect;
+			Color color;
+
+			Command(Resources::Drawable* d, const Rect& r, const Color& c) : drawable(d), rect(r), color(c) {}
+		};
+
+		std::vector<Command> commands;
+		Canvas* target;
+		bool recorded;
+	};
+
 	/// @interface Backend
 	/// @brief Base for rendering backend.
 	class Backend
 	{
 	public:
+		/// @brief Way the mask limits drawing.
+		enum class MaskMode
+		{
+			/// @brief Mask rects are drawn into stencil buffer.
+			Stencil,
+			/// @brief Drawing is clipped to every mask rect separately, stencil is not used.
+			Scissor,
+			/// @brief Scissor when mask is single rect, stencil otherwise.
+			Auto
+		};
+
 		virtual std::shared_ptr<Resources::RectangleShape> createRectangle(const Vec2& size, const Color& color) = 0;
 		virtual std::shared_ptr<Resources::TextResource> createText(const std::string& text, const Resources::FontResource& font, float size, const Color& color) = 0;
 
@@ -292,6 +431,9 @@ namespace Guider
 
 		virtual void deleteResource(Resources::Resource& resource) = 0;
 
+		/// @brief Pushes offset relative to current one.
+		/// 
+		/// @ref setDrawOrigin is called only when resulting origin differs from last applied one.
 		void pushDrawOffset(const Vec2& offset);
 		void popDrawOffset();
 		Vec2 getDrawOffset() const;
@@ -304,20 +446,95 @@ namespace Guider
 		virtual void pushMaskLayer() = 0;
 		virtual void popMaskLayer() = 0;
 		virtual void addToMask(const Rect& rect) = 0;
+		/// @brief Limits drawing to given rects, used instead of stencil mask in scissor mode.
+		/// 
+		/// Every drawing call has to be clipped to each rect separately.
+		/// Default implementation builds stencil mask from the rects, backends supporting scissor test should override it.
+		/// @param rects Disjoint rects in global coordinates.
+		virtual void useMaskRects(const std::vector<Rect>& rects);
+		/// @brief Disables mask enabled by @ref useMaskRects.
+		/// 
+		/// Default implementation clears and disables stencil mask.
+		virtual void disableMaskRects();
+
+		/// @brief Sets way the mask is applied.
+		void setMaskMode(MaskMode mode);
+		MaskMode getMaskMode() const noexcept;
+		/// @brief Limits drawing to mask, according to mask mode.
+		/// @param mask Mask in global coordinates.
+		void applyMask(const Region& mask);
+		/// @brief Disables mask enabled by @ref applyMask.
+		void releaseMask();
+
+		/// @brief Adds rect to mask, which is the damage region.
+		/// 
+		/// Mask is applied after all rects are collected, see @ref applyMask.
+		/// @param rect Rect relative to current draw offset.
+		void addDamagedRect(const Rect& rect);
+		/// @brief Returns area masked since last @ref resetDamage, in global coordinates.
+		const Region& getDamage();
+		/// @brief Clears damage region.
+		void resetDamage();
 
 		virtual std::shared_ptr<Canvas> getCanvas() = 0;
 
+		/// @brief Pushes bounds limited by current ones.
+		/// 
+		/// @ref setBounds is called only when resulting bounds differ from last applied ones.
 		void pushBounds(const Rect& rect);
 		void popBounds();
 		Rect getBounds() const;
 		virtual void setBounds(const Rect& rect) = 0;
+		/// @brief Forgets last applied origin and bounds.
+		/// 
+		/// Next push or pop applies them again, has to be called when backend state was changed directly.
+		void resetState();
+
+		/// @brief Redirects drawing state to offscreen layer.
+		/// 
+		/// Until @ref popLayer, draw offsets and bounds start from layers top left corner
+		/// and are applied to the layer instead of the main canvas.
+		/// @param layer Layer to draw on.
+		/// @param size Size of drawn area.
+		void pushLayer(Resources::ImageCanvas& layer, const Vec2& size);
+		/// @brief Restores drawing state from before last @ref pushLayer.
+		void popLayer();
+		/// @brief Sets canvas that origin and bounds apply to.
+		/// 
+		/// Default implementation supports main canvas only and throws std::logic_error for layers.
+		/// @param layer Layer canvas or nullptr for main canvas.
+		virtual void setLayer(Resources::ImageCanvas* layer);
 
 		virtual Vec2 getSize() const noexcept = 0;
 		virtual void setSize(const Vec2& size) = 0;
 
+		Backend();
+		virtual ~Backend() = default;
 	private:
 		std::vector<Vec2> offsets;
 		std::vector<Rect> bounds;
+		/// @brief Damaged rects not yet merged into region.
+		std::vector<Rect> damagedRects;
+		Region damage;
+		MaskMode maskMode;
+		/// @brief True if current mask was applied with @ref useMaskRects.
+		bool maskRects;
+		Vec2 appliedOrigin;
+		Rect appliedBounds;
+		bool originApplied, boundsApplied;
+
+		/// @brief Drawing state saved by @ref pushLayer.
+		class LayerState
+		{
+		public:
+			Resources::ImageCanvas* layer;
+			std::vector<Vec2> offsets;
+			std::vector<Rect> bounds;
+		};
+		std::vector<LayerState> layers;
+
+		void applyDrawOrigin(const Vec2& origin);
+		void applyBounds(const Rect& rect);
 	};
 
 	/// @brief Events class.
@@ -538,7 +755,13 @@ namespace Guider
 		/// @brief Invalidates visuals.
 		/// 
 		/// Tells container that this component need redraw.
+		/// Retained drawing is discarded.
 		virtual void invalidateVisuals();
+		/// @brief Requests redraw of unchanged component.
+		/// 
+		/// Used when component is drawn again only because its surroundings changed,
+		/// retained drawing is kept and replayed.
+		virtual void requestRedraw();
 
 		/// @brief Recursively invalidates components.
 		void invalidateRecursive();
@@ -546,11 +769,22 @@ namespace Guider
 		void invalidateVisualsRecursive();
 
 		/// @brief Measures components desired size.
+		/// 
+		/// Results are memoized per suggestion pair until component is invalidated,
+		/// actual measuring is done by @ref onMeasure.
+		/// Overriding it is still supported, but bypasses memoization, new components should override @ref onMeasure.
 		/// @param width Width sugesstion.
 		/// @param height Height suggestion.
 		/// @return Measurements desired by component.
 		virtual std::pair<DimensionDesc, DimensionDesc> measure(const DimensionDesc& width, const DimensionDesc& height);
 
+		/// @brief Returns number of measures answered from cache, counted for all components.
+		static size_t getMeasureCacheHits() noexcept;
+		/// @brief Returns number of measures that had to be computed, counted for all cacheable components.
+		static size_t getMeasureCacheMisses() noexcept;
+		/// @brief Resets measure cache counters.
+		static void resetMeasureCacheStats() noexcept;
+
 		/// @brief Returns current parent.
 		Component* getParent();
 		/// @brief Returns current parent.
@@ -568,6 +802,14 @@ namespace Guider
 		/// @name Callbacks
 		/// @{
 
+		/// @brief Measures components desired size, called by @ref measure on cache miss.
+		/// 
+		/// Result may depend only on suggestions, parent size and state which change invalidates component.
+		/// @param width Width sugesstion.
+		/// @param height Height suggestion.
+		/// @return Measurements desired by component.
+		virtual std::pair<DimensionDesc, DimensionDesc> onMeasure(const DimensionDesc& width, const DimensionDesc& height);
+
 		/// @brief Callback for bounds change.
 		/// 
 		/// @note Preferred way of handling is to mark internal structure
@@ -583,6 +825,12 @@ namespace Guider
 		/// Called every time direct child is invalidated.
 		/// @param c child
 		virtual void onChildNeedsRedraw(Component& c);
+		/// @brief Callback for childs bounds change.
+		/// 
+		/// Called after child's @ref onResize.
+		/// @param c child
+		/// @param lastBounds bounds from before the change.
+		virtual void onChildResize(Component& c, const Rect& lastBounds);
 		/// @brief Callback for drawing mask.
 		/// 
 		/// Called every time direct child needs redraw.
@@ -625,6 +873,25 @@ namespace Guider
 		/// @param canvas Canvas to draw on.
 		void redraw(Canvas& canvas);
 
+		/// @brief Enables caching of component as layer.
+		/// 
+		/// Cached component with its whole subtree is drawn into offscreen image,
+		/// which is then drawn instead, until something inside the subtree invalidates visuals or size changes.
+		/// @param cache True to enable.
+		void setCacheAsLayer(bool cache);
+		/// @brief Returns true if component is cached as layer.
+		bool isCachedAsLayer() const noexcept;
+
+		/// @brief Enables retained drawing.
+		/// 
+		/// Retained component records its drawing into a display list and replays it,
+		/// until @ref invalidateVisuals is called or its size changes.
+		/// Component has to draw only through @ref Canvas methods and redraw itself completely.
+		/// @param retained True to enable.
+		virtual void setRetained(bool retained);
+		/// @brief Returns true if drawing is retained.
+		bool isRetained() const noexcept;
+
 		/// @brief Sets event callback.
 		/// 
 		/// Callback is called every time component receives an event.
@@ -658,12 +925,38 @@ namespace Guider
 
 	protected:
 		void setBounds(Component& c, const Rect& r) const;
+		/// @brief Moves child without resizing it and without requesting its redraw.
+		/// 
+		/// Drawing is relative to bounds, so only parent has to update its pixels, e.g. by copying them.
+		void moveBounds(Component& c, const Rect& r) const;
 		void setClean();
+		/// @brief Disables measure memoization.
+		/// 
+		/// Required when @ref onMeasure has side effects or depends on state not covered by invalidation.
+		void disableMeasureCache();
 	private:
+		/// @brief Memoized result of @ref onMeasure.
+		class MeasureCacheEntry
+		{
+		public:
+			DimensionDesc width, height;
+			Vec2 parentSize;
+			std::pair<DimensionDesc, DimensionDesc> result;
+		};
+		/// @brief Maximal number of memoized suggestion pairs.
+		static constexpr size_t measureCacheSize = 4;
+
+		/// @brief Counted atomically, components may be measured concurrently.
+		static std::atomic<size_t> measureCacheHits, measureCacheMisses;
+
+		friend class DirtyList;
+
 		Backend* backend;
 		Component* parent;
 		bool clean;
 		bool toRedraw;
+		/// @brief Generations of dirty lists of parent this component belongs to, by list kind.
+		uint64_t dirtyStamps[2];
 		Rect bounds;
 		bool hasMouseOver;
 		bool hasMouseFocus;
@@ -673,12 +966,150 @@ namespace Guider
 
 		std::function<bool(const Event&)> eventCallback;
 
+		/// @brief Recording of last drawing, exists only for retained components.
+		std::unique_ptr<DisplayList> displayList;
+
+		bool measureCacheEnabled;
+		std::vector<MeasureCacheEntry> measureCache;
+		/// @brief Entry replaced by next miss when cache is full.
+		size_t measureCacheNext;
+
+		bool cacheAsLayer;
+		/// @brief Offscreen image of subtree, created on first draw.
+		std::shared_ptr<Resources::ImageCanvas> layer;
+		Vec2 layerSize;
+		bool layerValid;
+
+		/// @brief Replays display list, recording it first if needed.
+		void drawRetained(Canvas& canvas);
+		/// @brief Draws cached layer, rendering subtree into it first if needed.
+		void drawLayer(Canvas& canvas);
+		/// @brief Invalidates layers of this component and its ancestors.
+		void invalidateLayers();
+		/// @brief Marks ancestor of invalidated component as dirty, without invalidating its visuals.
+		void stain();
+
 		void setMouseOver();
 		void resetMouseOver();
 		void setMouseFocus();
 		void resetMouseFocus();
 	};
 
+	/// @brief Uniform grid over bounds of components.
+	///
+	/// Used by containers for hit testing, so mouse events do not visit every child.
+	/// Components spanning many cells are kept in separate list.
+	class SpatialIndex
+	{
+	public:
+		/// @brief Indexed component with its insertion order.
+		class Item
+		{
+		public:
+			size_t key;
+			Component* component;
+
+			Item(size_t k, Component* c) : key(k), component(c) {}
+		};
+
+		/// @brief Inserts component or moves it to new bounds.
+		///
+		/// Moved component keeps its insertion order.
+		void update(Component& c, const Rect& bounds);
+		/// @brief Removes component.
+		void remove(Component& c);
+		/// @brief Removes all components and resets insertion order.
+		void clear();
+
+		/// @brief Returns insertion order of component.
+		/// Throws exception if component is not indexed.
+		size_t getKey(const Component& c) const;
+		/// @brief Returns number of indexed components.
+		size_t size() const noexcept;
+
+		/// @brief Appends components which bounds contain point.
+		///
+		/// Output is not sorted.
+		void query(const Vec2& point, std::vector<Item>& out) const;
+		/// @brief Appends components which bounds intersect rect, touching edges included.
+		///
+		/// Output is not sorted and can contain duplicates.
+		void query(const Rect& rect, std::vector<Item>& out) const;
+
+		/// @param cellSize Width and height of single cell.
+		SpatialIndex(float cellSize = 64.f);
+	private:
+		struct Entry
+		{
+			Rect bounds;
+			size_t key;
+			bool large;
+		};
+
+		static constexpr size_t maxCellsPerItem = 64;
+
+		float cellSize;
+		size_t nextKey;
+		std::unordered_map<const Component*, Entry> entries;
+		std::unordered_map<uint64_t, std::vector<Item>> cells;
+		std::vector<Item> large;
+
+		static uint64_t cellKey(int32_t x, int32_t y);
+		/// @brief Returns cell containing coordinate, clamped to indexed range.
+		/// 
+		/// Flag is cleared if coordinate is outside that range, infinite or NaN.
+		int32_t cellIndex(float v, bool& inRange) const;
+		/// @brief Computes cells covered by bounds, returns false if there are too many of them or bounds are outside indexed range.
+		bool cellRange(const Rect& bounds, int32_t& x0, int32_t& y0, int32_t& x1, int32_t& y1) const;
+		void insert(const Component& c, const Entry& e);
+		void erase(const Component& c, const Entry& e);
+	};
+
+	/// @brief Set of children waiting for update or redraw.
+	///
+	/// Membership is stamped into the component, so inserting and testing neither hashes nor allocates
+	/// once storage grew, and components are iterated in order of insertion.
+	/// Component can be member of single list of each kind at a time, which holds for lists of its parent.
+	class DirtyList
+	{
+	public:
+		/// @brief Purpose of the list, each kind has its own stamp in component.
+		enum class Kind
+		{
+			Update = 0,
+			Redraw = 1
+		};
+
+		using const_iterator = std::vector<Component*>::const_iterator;
+
+		/// @brief Inserts component.
+		/// @return True if component was not member yet.
+		bool insert(Component* c);
+		/// @brief Removes component, linear in size of the list.
+		void erase(Component* c);
+		/// @brief Returns true if component is member.
+		bool contains(const Component* c) const noexcept;
+		/// @brief Removes all components in constant time.
+		void clear() noexcept;
+
+		bool empty() const noexcept;
+		size_t size() const noexcept;
+		/// @note Inserting while iterating invalidates iterators.
+		const_iterator begin() const noexcept;
+		const_iterator end() const noexcept;
+
+		DirtyList(Kind kind);
+		DirtyList(const DirtyList&) = delete;
+		DirtyList& operator=(const DirtyList&) = delete;
+	private:
+		Kind kind;
+		/// @brief Stamp of current members, unique among all lists, so stale stamps never match.
+		uint64_t generation;
+		std::vector<Component*> items;
+
+		static std::atomic<uint64_t> lastGeneration;
+	};
+
 	/// @interface Container
 	/// @brief Gui container base.
 	class Container : public Component
@@ -796,7 +1227,32 @@ namespace Guider
 			return Iterator((IteratorBase*)new T(std::forward<Args>(args)...));
 		}
 
-		virtual void invalidateVisuals() override;
+		/// @brief Non-owning reference to callable invoked for every child.
+		///
+		/// Unlike std::function it never allocates, referenced callable must outlive the visitor.
+		class ChildVisitor
+		{
+		public:
+			inline void operator () (Component& c) const
+			{
+				func(object, c);
+			}
+
+			template<typename F, typename = std::enable_if_t<!std::is_same<std::decay_t<F>, ChildVisitor>::value>>
+			ChildVisitor(F& f) : object(const_cast<void*>(static_cast<const void*>(&f))), func([](void* o, Component& c) {
+				(*static_cast<F*>(o))(c);
+			}) {}
+		private:
+			void* object;
+			void (*func)(void*, Component&);
+		};
+
+		/// @brief Requests redraw of container and all its children.
+		virtual void requestRedraw() override;
+		/// @brief Containers draw their children directly and cannot be retained.
+		/// 
+		/// Throws std::logic_error when enabling.
+		virtual void setRetained(bool retained) override;
 
 		/// @brief Adds child.
 		/// @param child 
@@ -810,6 +1266,19 @@ namespace Guider
 		/// @brief Returns iterator to first element.
 		virtual Iterator firstElement() = 0;
 
+		/// @brief Calls visitor for every child, in the same order as @ref firstElement.
+		///
+		/// Default implementation uses @ref firstElement, containers should override it
+		/// with allocation free loop over their storage.
+		virtual void visitChildren(const ChildVisitor& visitor);
+
+		/// @brief Calls f for every child without allocating.
+		/// @param f Callable taking Component&.
+		template<typename F> inline void forEachChild(F&& f)
+		{
+			visitChildren(ChildVisitor(f));
+		}
+
 		virtual bool handleEvent(const Event& event) override;
 		/// @brief Adjust element to be passed to child component.
 		/// @param event Original event.
@@ -819,17 +1288,68 @@ namespace Guider
 		/// @param event 
 		/// @param component Child component.
 		void handleEventForComponent(const Event& event, Component& component);
+
+		virtual void onChildResize(Component& c, const Rect& lastBounds) override;
+
+		Container();
+	protected:
+		/// @brief Enables spatial index for hit testing and @ref queryChildren.
+		///
+		/// Implementation calling it must call @ref invalidateSpatialIndex every time child is added or removed.
+		/// Children of containers which don't call it are searched linearly, so they never see stale index.
+		void useSpatialIndex() noexcept;
+		/// @brief Marks spatial index as outdated.
+		///
+		/// Must be called every time child is added or removed, if @ref useSpatialIndex was called.
+		void invalidateSpatialIndex();
+		/// @brief Appends children which bounds intersect rect, touching edges included.
+		///
+		/// Items are keyed by order of children, output is not sorted and can contain duplicates.
+		/// Only children near rect are visited when spatial index is used.
+		void queryChildren(const Rect& rect, std::vector<SpatialIndex::Item>& out);
+		/// @brief Returns order of child among children of this container.
+		size_t getChildKey(const Component& c);
+	private:
+		/// @brief Minimal number of children for which spatial index is used.
+		static constexpr size_t spatialIndexThreshold = 16;
+
+		SpatialIndex spatialIndex;
+		/// @brief True if implementation keeps index up to date, see @ref useSpatialIndex.
+		bool spatialIndexUsed;
+		bool spatialIndexDirty;
+		bool spatialIndexEnabled;
+		/// @brief Children that have mouse over or mouse focus.
+		std::vector<Component*> mouseTracked;
+		std::vector<SpatialIndex::Item> hits;
+
+		void updateSpatialIndex();
+		void handleMouseEvent(const Event& event);
 	};
 
 	/// @brief Gui engine.
 	class Engine : public Container
 	{
 	public:
+		/// @brief Event queue counters.
+		class EventStats
+		{
+		public:
+			/// @brief Events passed to @ref postEvent.
+			size_t posted;
+			/// @brief Mouse moves merged into later ones.
+			size_t coalesced;
+			/// @brief Events dispatched to components.
+			size_t delivered;
+
+			EventStats() : posted(0), coalesced(0), delivered(0) {}
+		};
+
 		virtual void addChild(const Component::Type& child) override;
 		virtual void removeChild(const Component::Type& child) override;
 		virtual void clearChildren() override;
 
 		virtual Iterator firstElement() override;
+		virtual void visitChildren(const ChildVisitor& visitor) override;
 
 		virtual void onChildNeedsRedraw(Component& c) override;
 
@@ -837,13 +1357,29 @@ namespace Guider
 		/// @param size 
 		void resize(const Vec2& size);
 		/// @brief Updates gui.
+		///
+		/// Delivers queued events first.
 		void update();
 
+		/// @brief Queues event, to be delivered at the beginning of next update.
+		///
+		/// Consecutive mouse moves are coalesced, only the last position is delivered.
+		/// Order of all other events is preserved.
+		/// @param event Event to queue.
+		void postEvent(const Event& event);
+		/// @brief Delivers queued events.
+		void flushEvents();
+		/// @brief Returns event queue counters.
+		const EventStats& getEventStats() const noexcept;
+		/// @brief Resets event queue counters.
+		void resetEventStats();
+
 		virtual void onMaskDraw(Canvas& canvas) const override;
 		virtual void onDraw(Canvas& canvas) override;
 		virtual void onRedraw(Canvas& canvas) override;
 		/// @brief Draws gui.
-		void draw();
+		/// @return Area that changed, in global coordinates.
+		Region draw();
 
 		Engine(Backend& b);
 
@@ -852,8 +1388,10 @@ namespace Guider
 	private:
 		using IteratorType = CommonIteratorTemplate<std::vector<Component::Type>::iterator>;
 		Backend& backend;
-		std::unordered_set<Component*> toRedraw;
+		DirtyList toRedraw;
 		std::shared_ptr<Canvas> canvas;
 		std::vector<Component::Type> elements;
+		std::vector<Event> events, dispatchedEvents;
+		EventStats eventStats;
 	};
 }
\ No newline at end of file
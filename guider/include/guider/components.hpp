@@ -30,7 +30,7 @@ namespace Guider
 		/// @return Returns pair (width, height). Fields that are not required have undefined value.
 		virtual std::pair<float, float> getContentSize(bool getWidth, bool getHeight) = 0;
 
-		virtual std::pair<DimensionDesc, DimensionDesc> measure(const DimensionDesc& width, const DimensionDesc& height) override;
+		virtual std::pair<DimensionDesc, DimensionDesc> onMeasure(const DimensionDesc& width, const DimensionDesc& height) override;
 
 		CommonComponent() = default;
 		/// @brief Constructs component from xml.
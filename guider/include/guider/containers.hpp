@@ -3,7 +3,9 @@
 #include <guider/manager.hpp>
 #include <guider/base.hpp>
 #include <stdexcept>
+#include <limits>
 #include <list>
+#include <vector>
 
 namespace Guider
 {
@@ -19,6 +21,7 @@ namespace Guider
 		virtual void clearChildren() override;
 
 		virtual Iterator firstElement() override;
+		virtual void visitChildren(const ChildVisitor& visitor) override;
 
 		virtual void poke() override;
 
@@ -28,6 +31,9 @@ namespace Guider
 
 		virtual void onMaskDraw(Canvas& canvas) const override;
 		virtual void onDraw(Canvas& canvas) override;
+		virtual void onRedraw(Canvas& canvas) override;
+
+		AbsoluteContainer();
 	private:
 		struct Element
 		{
@@ -65,7 +71,54 @@ namespace Guider
 		};
 		std::vector<Element> children;
 
-		std::unordered_set<Component*> toUpdate;
+		/// @brief Children which have to be measured again.
+		DirtyList toUpdate;
+		DirtyList toRedraw;
+		/// @brief Children found by @ref redrawOverlapping and @ref onDraw, kept to reuse storage.
+		std::vector<SpatialIndex::Item> overlapping;
+
+		/// @brief Redraws children intersecting given rect.
+		void redrawOverlapping(const Rect& rect);
+	};
+
+	/// @brief Fenwick tree of item sizes.
+	/// 
+	/// Changing single size, computing offset of item and finding item at given offset are O(log n).
+	/// Sums are accumulated in double precision and rounded to float when returned,
+	/// so errors of offsets in very long lists stay close to single float rounding.
+	class PrefixSumTree
+	{
+	public:
+		/// @brief Appends value.
+		void pushBack(float value);
+		/// @brief Removes value at given index, tree is rebuilt in O(n).
+		void erase(size_t index);
+		void clear();
+		/// @brief Replaces all values, tree is built in O(n).
+		void assign(const std::vector<float>& values);
+
+		/// @brief Sets value at given index.
+		void set(size_t index, float value);
+		float get(size_t index) const;
+
+		/// @brief Returns sum of first count values.
+		float prefix(size_t count) const;
+		/// @brief Returns sum of all values.
+		float total() const;
+		/// @brief Returns the largest count of leading values, which sum does not exceed given value.
+		size_t upperBound(float value) const;
+		/// @brief Same as @ref upperBound, but every value is increased by weight times matching value of counts.
+		/// 
+		/// Both trees must have the same size.
+		size_t upperBound(float value, const PrefixSumTree& counts, float weight) const;
+
+		size_t size() const noexcept;
+	private:
+		std::vector<double> values;
+		/// @brief Fenwick tree, indexed from 1.
+		std::vector<double> tree;
+
+		void rebuild();
 	};
 
 	//TODO: rewrite
@@ -83,6 +136,22 @@ namespace Guider
 		void setOffset(float offset);
 		float getOffset() const noexcept;
 
+		/// @brief Enables estimating sizes of children.
+		/// 
+		/// Only children near viewport are measured, others are assumed to have estimated size.
+		/// Total size is corrected as children get measured.
+		/// @param enabled True to enable.
+		/// @param size Estimated size of child, negative to use average size of measured children.
+		void setSizeEstimation(bool enabled, float size = -1.f);
+		bool isSizeEstimationEnabled() const noexcept;
+
+		/// @brief Enables scrolling by copying.
+		/// 
+		/// Content is kept in offscreen image, scrolling shifts it and draws only children exposed by the shift.
+		/// @param enabled True to enable.
+		void setScrollByCopy(bool enabled);
+		bool isScrollByCopyEnabled() const noexcept;
+
 		virtual void addChild(const Component::Type& child) override;
 		virtual void removeChild(const Component::Type& child) override;
 		void removeChild(unsigned n);
@@ -94,14 +163,22 @@ namespace Guider
 		virtual void onDraw(Canvas& canvas) override;
 		virtual void onRedraw(Canvas& canvas) override;
 
+		/// @brief Requests redraw of the list and its visible children.
+		/// 
+		/// Children outside of viewport are redrawn when they enter it.
+		virtual void requestRedraw() override;
+
 		virtual void poke() override;
 		virtual void onResize(const Rect& lastBounds) override;
 		virtual void onChildStain(Component& c) override;
 		virtual void onChildNeedsRedraw(Component& c) override;
 
+		virtual bool handleEvent(const Event& event) override;
+
 		virtual Iterator firstElement() override;
+		virtual void visitChildren(const ChildVisitor& visitor) override;
 
-		std::pair<DimensionDesc, DimensionDesc> measure(const DimensionDesc& w, const DimensionDesc& h) override;
+		std::pair<DimensionDesc, DimensionDesc> onMeasure(const DimensionDesc& w, const DimensionDesc& h) override;
 
 		ListContainer();
 
@@ -111,13 +188,16 @@ namespace Guider
 		{
 		public:
 			std::shared_ptr<Component> component;
-			float size, newSize, offset;
+			/// @brief Last measured size, mirrored in @ref sizes, 0 until measured.
+			float size;
+			bool measured;
 
-			Element(const std::shared_ptr<Component>& component, float size, float offset);
+			Element(const std::shared_ptr<Component>& component, float size);
 			Element(Element&&) noexcept = default;
+			Element& operator=(Element&&) noexcept = default;
 		};
 
-		using iterator = std::list<Element>::iterator;
+		using iterator = std::vector<Element>::iterator;
 
 		class IteratorType : public IteratorTemplate<IteratorType>
 		{
@@ -146,48 +226,228 @@ namespace Guider
 		Orientation orientation;
 		float size, offset, newOffset;
 
-		std::list<Element> children;
-		std::unordered_set<Component*> toUpdate, toOffset;
-		std::unordered_set<Component*> toRedraw;
+		std::vector<Element> children;
+		/// @brief Measured sizes of children.
+		/// 
+		/// Offset of child is prefix sum of sizes before it, plus estimated size of unmeasured children before it.
+		PrefixSumTree sizes;
+		/// @brief 1 for unmeasured children, 0 for measured ones.
+		PrefixSumTree unmeasured;
+		double measuredSum;
+		size_t measuredCount;
+		bool estimation;
+		float estimatedSize;
+		DirtyList toUpdate;
+		DirtyList toRedraw;
+
+		std::unordered_map<Component*, size_t> childMapping;
+
+		/// @brief Range of visible children indices.
+		size_t visibleBegin;
+		size_t visibleEnd;
+		/// @brief Visible range of last layout.
+		size_t laidOutBegin;
+		size_t laidOutEnd;
+
+		Color backgroundColor;
+
+		bool firstDraw;
+
+		bool scrollByCopy;
+		/// @brief Drawn content and image it is copied into when scrolling.
+		std::shared_ptr<Resources::ImageCanvas> content, contentBack;
+		Vec2 contentSize;
+		bool contentValid;
+		/// @brief Offset at which content was drawn.
+		float contentOffset;
+
+		/// @brief Updates content image and draws it.
+		void drawContent(Canvas& canvas);
+
+		void setChildSize(size_t index, float size);
+		/// @brief Makes size of child estimated.
+		void resetChildSize(size_t index);
+		/// @brief Returns size assumed for unmeasured children.
+		float getEstimatedSize() const;
+		float getChildOffset(size_t index) const;
+		float getTotalSize() const;
+		/// @brief Returns index of first child which ends after given offset.
+		size_t getChildAt(float offset) const;
+		/// @brief Measures unmeasured children within one viewport from the visible ones.
+		/// 
+		/// Repeats until measured sizes stop changing the range.
+		void measureNearChildren(std::vector<Component*>& measured);
+		void recalculateVisibleElements();
+	};
+
+	/// @brief Source of items displayed by @ref RecyclerListContainer.
+	class ListAdapter
+	{
+	public:
+		/// @brief Returns number of items.
+		virtual size_t getItemCount() const = 0;
+		/// @brief Creates view which can display any item.
+		virtual Component::Type createView() = 0;
+		/// @brief Makes view display item at given index.
+		/// 
+		/// View may be displaying other item before.
+		virtual void bindView(Component& view, size_t index) = 0;
+		/// @brief Returns expected size of item along list orientation.
+		/// 
+		/// Used until item is bound and measured.
+		/// Default implementation returns negative value, which means average size of measured items.
+		virtual float estimateSize(size_t index) const;
+
+		virtual ~ListAdapter() = default;
+	};
+
+	/// @brief List which items are provided by adapter.
+	/// 
+	/// Only items inside viewport have views, views of items leaving it are rebound to items entering it.
+	/// Item sizes are estimated until items are shown.
+	class RecyclerListContainer : public Container
+	{
+	public:
+		static void registerProperties(Manager& manager, const std::string& name);
+
+		void setAdapter(const std::shared_ptr<ListAdapter>& adapter);
+		std::shared_ptr<ListAdapter> getAdapter() const;
+
+		/// @brief Reloads all items.
+		/// 
+		/// Must be called when items are inserted, removed or reordered.
+		void notifyDataSetChanged();
+		/// @brief Binds item again, if it is visible.
+		void notifyItemChanged(size_t index);
+
+		void setOrientation(Orientation orientation);
+		Orientation getOrientation() const noexcept;
+
+		void setBackgroundColor(const Color& color);
+		Color getBackgroundColor() const noexcept;
+
+		void setOffset(float offset);
+		float getOffset() const noexcept;
+
+		/// @brief Sets maximal number of unused views kept for later items.
+		void setPoolSize(size_t size);
+		size_t getPoolSize() const noexcept;
 
-		std::unordered_map<Component*, iterator> childMapping;
+		/// @brief Returns view bound to item, nullptr if item is not visible.
+		Component::Type getItemView(size_t index) const;
+		/// @brief Returns first item and past the last item which have views.
+		std::pair<size_t, size_t> getVisibleRange() const noexcept;
+		/// @brief Returns offset of item from start of the list, estimated for items not shown yet.
+		float getItemOffset(size_t index) const;
 
-		std::unordered_set<Component*> toMeasure, updated;
+		/// @brief Views are created by adapter, throws std::logic_error.
+		virtual void addChild(const Component::Type& child) override;
+		/// @brief Views are created by adapter, throws std::logic_error.
+		virtual void removeChild(const Component::Type& child) override;
+		/// @brief Drops all views, visible items get new ones on next update.
+		virtual void clearChildren() override;
 
-		iterator visibleBegin;
-		iterator visibleEnd;
-		std::unordered_set<Component*> visible, beforeVisible;
+		virtual void onMaskDraw(Canvas& canvas) const override;
+		virtual void onDraw(Canvas& canvas) override;
+		virtual void onRedraw(Canvas& canvas) override;
+
+		/// @brief Requests redraw of the list and its visible views.
+		virtual void requestRedraw() override;
+
+		virtual void poke() override;
+		virtual void onResize(const Rect& lastBounds) override;
+		virtual void onChildStain(Component& c) override;
+		virtual void onChildNeedsRedraw(Component& c) override;
+
+		virtual Iterator firstElement() override;
+		virtual void visitChildren(const ChildVisitor& visitor) override;
+
+		std::pair<DimensionDesc, DimensionDesc> onMeasure(const DimensionDesc& w, const DimensionDesc& h) override;
+
+		RecyclerListContainer();
+
+		RecyclerListContainer(Manager& manager, const XML::Tag& tag, const StylingPack& pack);
+	private:
+		using IteratorType = CommonIteratorTemplate<std::vector<Component::Type>::iterator>;
+
+		std::shared_ptr<ListAdapter> adapter;
+
+		Orientation orientation;
+		float size, offset, newOffset;
+
+		/// @brief Sizes of measured items and items estimated by adapter, 0 for others.
+		/// 
+		/// Offset of item is prefix sum of sizes before it, plus average measured size of unknown items before it.
+		PrefixSumTree sizes;
+		/// @brief 1 for items neither measured nor estimated by adapter, 0 for others.
+		PrefixSumTree unknown;
+		/// @brief Items measured at least once.
+		std::vector<bool> measured;
+		double measuredSum;
+		size_t measuredCount;
+		/// @brief Set when sizes have to be estimated again.
+		bool itemsChanged;
+
+		/// @brief Views of visible items, starting with item @ref firstItem.
+		std::vector<Component::Type> views;
+		size_t firstItem;
+		std::unordered_map<Component*, size_t> viewMapping;
+		/// @brief Unused views.
+		std::vector<Component::Type> pool;
+		size_t poolSize;
+
+		DirtyList toUpdate;
+		DirtyList toRedraw;
 
 		Color backgroundColor;
 
 		bool firstDraw;
 
-		void adjustVisibleElements();
-		void recalculateVisibleElements();
+		/// @brief Estimates sizes of all items again, all views are released.
+		void resetItems();
+		/// @brief Returns size assumed for unknown items.
+		float getEstimatedSize() const;
+		float getTotalSize() const;
+		/// @brief Returns index of first item which ends after given offset.
+		size_t getItemAt(float offset) const;
+		/// @brief Measures view and stores its size as size of item.
+		void measureItem(Component& view, size_t index);
+		/// @brief Returns view from pool or creates one, view is bound to item.
+		Component::Type obtainView(size_t index);
+		void recycleView(const Component::Type& view);
+		/// @brief Binds views to items in viewport, until measured sizes stop changing it.
+		void bindVisibleItems();
 	};
 
+	class ThreadPool;
+
 	class ConstraintsContainer : public Container, public std::enable_shared_from_this<ConstraintsContainer>
 	{
 	public:
+		/// @brief Slot of missing attachment, its edges are at 0.
+		static constexpr size_t noSlot = std::numeric_limits<size_t>::max();
+
+		/// @brief Attachments and target are slots of components in layout storage.
 		class RegularConstraintData
 		{
 		public:
-			Component* left, * right, * target;
+			size_t left, right, target;
 			float leftOffset, rightOffset, flow, size;
 
-			RegularConstraintData() : left(nullptr), right(nullptr), target(nullptr), leftOffset(0), rightOffset(0), flow(0), size(0) {}
+			RegularConstraintData() : left(noSlot), right(noSlot), target(noSlot), leftOffset(0), rightOffset(0), flow(0), size(0) {}
 			RegularConstraintData(RegularConstraintData&& t) noexcept : left(t.left), right(t.right), target(t.target), leftOffset(t.leftOffset), rightOffset(t.rightOffset), flow(t.flow), size(t.size) {}
 		};
 
+		/// @brief Attachments and targets are slots of components in layout storage.
 		class ChainConstraintData
 		{
 		public:
-			Component* left, * right;
+			size_t left, right;
 			float leftOffset, rightOffset;
-			std::vector<std::pair<Component*, float>> targets;
+			std::vector<std::pair<size_t, float>> targets;
 			float spacing;
 
-			ChainConstraintData() : left(nullptr), right(nullptr), leftOffset(0), rightOffset(0), spacing(0) {}
+			ChainConstraintData() : left(noSlot), right(noSlot), leftOffset(0), rightOffset(0), spacing(0) {}
 			ChainConstraintData(ChainConstraintData&& t) noexcept : left(t.left), right(t.right), leftOffset(t.leftOffset), rightOffset(t.rightOffset), targets(std::move(t.targets)), spacing(t.spacing) {}
 		};
 		class Constraint
@@ -235,8 +495,8 @@ namespace Guider
 
 			void setSecondEdge(bool start);
 
-			std::vector<Component*> getDeps() const;
-			bool isFor(const Component& c) const;
+			std::vector<size_t> getDeps() const;
+			bool isFor(size_t slot) const;
 
 			Constraint(Type type, Orientation o);
 
@@ -265,12 +525,22 @@ namespace Guider
 		class Cluster
 		{
 		public:
-			std::unordered_set<Constraint*> constraints;
-			std::unordered_set<Component*> components;
-			std::unordered_map<Component*, size_t> dependencies;
-
-			Cluster() = default;
-			Cluster(Cluster&& t) noexcept : constraints(std::move(t.constraints)), components(std::move(t.components)), dependencies(std::move(t.dependencies)) {}
+			std::vector<Constraint*> constraints;
+			/// @brief Slots of constrained components.
+			std::vector<size_t> components;
+			/// @brief Number of references to slots this cluster depends on.
+			std::unordered_map<size_t, size_t> dependencies;
+			/// @brief Position in order of dependencies, cluster comes after every cluster it depends on.
+			size_t order;
+			/// @brief If true, cluster is solved again on next layout.
+			bool dirty;
+			/// @brief Mark of last search which visited this cluster.
+			uint64_t visited;
+			/// @brief Length of longest chain of clusters it depends on, in last parallel layout.
+			size_t level;
+
+			Cluster() : order(0), dirty(false), visited(0), level(0) {}
+			Cluster(Cluster&& t) noexcept : constraints(std::move(t.constraints)), components(std::move(t.components)), dependencies(std::move(t.dependencies)), order(t.order), dirty(t.dirty), visited(t.visited), level(t.level) {}
 		};
 
 		class ClusterHash
@@ -285,6 +555,7 @@ namespace Guider
 		class RegularConstraintBuilder
 		{
 		private:
+			ConstraintsContainer& container;
 			Constraint& constraint;
 			std::list<Cluster>::iterator cluster;
 		public:
@@ -305,7 +576,7 @@ namespace Guider
 
 			void applyChanges();
 
-			RegularConstraintBuilder(Constraint& c, std::list<Cluster>::iterator cc) : constraint(c), cluster(cc)
+			RegularConstraintBuilder(ConstraintsContainer& owner, Constraint& c, std::list<Cluster>::iterator cc) : container(owner), constraint(c), cluster(cc)
 			{
 				if (c.getType() != Constraint::Type::Regular)
 					throw std::logic_error("Wrong constraint type");
@@ -314,6 +585,7 @@ namespace Guider
 		class ChainConstraintBuilder
 		{
 		private:
+			ConstraintsContainer& container;
 			Constraint& constraint;
 			std::list<Cluster>::iterator cluster;
 		public:
@@ -346,7 +618,7 @@ namespace Guider
 			{
 				attachBetween(start, startToStart, offset, end, endToStart, offset);
 			}
-			ChainConstraintBuilder(Constraint& c, std::list<Cluster>::iterator cc) : constraint(c), cluster(cc)
+			ChainConstraintBuilder(ConstraintsContainer& owner, Constraint& c, std::list<Cluster>::iterator cc) : container(owner), constraint(c), cluster(cc)
 			{
 				if (c.getType() != Constraint::Type::Chain)
 					throw std::logic_error("Wrong constraint type");
@@ -361,6 +633,14 @@ namespace Guider
 		/// @param color new background color.
 		void setBackgroundColor(const Color& color);
 
+		/// @brief Sets pool solving independent clusters concurrently, nullptr solves them serially.
+		///
+		/// Clusters are grouped by levels of dependencies and each level is solved in parallel, together with measuring of its components,
+		/// so components of different clusters have to be measurable concurrently and must not invalidate themselves while measured.
+		/// Resulting layout is the same as of serial solving. Pool may be shared by many containers.
+		void setThreadPool(const std::shared_ptr<ThreadPool>& pool);
+		const std::shared_ptr<ThreadPool>& getThreadPool() const noexcept;
+
 		virtual void poke() override;
 
 		virtual void onResize(const Rect& bounds) override;
@@ -369,13 +649,14 @@ namespace Guider
 
 		virtual bool handleEvent(const Event& event) override;
 
-		std::pair<DimensionDesc, DimensionDesc> measure(const DimensionDesc& w, const DimensionDesc& h) override;
+		std::pair<DimensionDesc, DimensionDesc> onMeasure(const DimensionDesc& w, const DimensionDesc& h) override;
 
 		virtual void removeChild(const Component::Type& child) override;
 		virtual void clearChildren() override;
 		virtual void addChild(const Component::Type& child) override;
 
 		virtual Iterator firstElement() override;
+		virtual void visitChildren(const ChildVisitor& visitor) override;
 
 		/// @brief Creates regural constraint for given element.
 		/// @param orientation either Vertical or Horizontal,
@@ -401,33 +682,105 @@ namespace Guider
 		using IteratorType = CommonIteratorTemplate<std::vector < std::shared_ptr<Component> >::iterator>;
 
 		std::vector<std::shared_ptr<Component>> children;
-		std::unordered_map<Component*, Rect> boundaries;
+		/// @brief Slots of children, in order of children.
+		std::vector<size_t> childSlots;
+
+		/// @brief Layout storage, every component taking part in layout gets dense slot index.
+		/// Slot 0 is this container, with bounds at (0, 0).
+		std::vector<float> slotLeft, slotTop, slotWidth, slotHeight;
+		std::vector<Component*> slotComponents;
+		/// @brief Cluster of each slot, end of clusters if slot is not constrained.
+		std::vector<std::list<Cluster>::iterator> slotClusters;
+		/// @brief Clusters depending on each slot, once per reference.
+		std::vector<std::vector<Cluster*>> slotDependents;
+		std::vector<size_t> freeSlots;
+		std::unordered_map<const Component*, size_t> slots;
+
 		std::list<Constraint> constraints;
-		//TODO: move other elements to using iterators instead of pointers
-		//std::unordered_map<Constraint*, std::list<Constraint>::iterator> constraintMapping;
 		std::list<Cluster> clusters;
-
-		std::unordered_map<const Component*, std::list<Cluster>::iterator> clusterMapping;
-		std::unordered_set<Component*> updated;
-
-		std::unordered_set<Component*> needsRedraw;
+		/// @brief Clusters indexed by their order, places of removed ones are empty until compacted.
+		std::vector<Cluster*> orderedClusters;
+		size_t emptyOrders;
+		uint64_t searchMark;
+		/// @brief Clusters visited by ordering searches, kept to reuse storage.
+		std::vector<Cluster*> forwardSearch, backwardSearch;
+		/// @brief Dirty clusters, heap ordered by position in order of dependencies.
+		std::vector<Cluster*> dirtyClusters;
+		/// @brief Slots which bounds changed since layout was last applied.
+		std::vector<size_t> changedSlots;
+		/// @brief Bounds of cluster components before it is solved, kept to reuse storage.
+		std::vector<Rect> solvedBounds;
+		/// @brief Offsets of bounds of clusters solved in parallel in @ref solvedBounds.
+		std::vector<size_t> solvedOffsets;
+		/// @brief Clusters grouped by level, kept to reuse storage.
+		std::vector<std::vector<Cluster*>> levels;
+
+		std::shared_ptr<ThreadPool> threadPool;
+		/// @brief Partial layouts with fewer dirty clusters are solved serially, grouping them costs more than it saves.
+		static constexpr size_t parallelDirtyClusters = 64;
+
+		DirtyList updated;
+
+		DirtyList needsRedraw;
 		std::unordered_map<Component*, Rect> drawnLastFrame;
+		/// @brief Areas of children removed since last frame.
+		std::vector<Rect> exposed;
+		/// @brief Children drawn again in current frame, kept to reuse storage.
+		std::vector<SpatialIndex::Item> overlapping;
 
 		bool firstDraw;
 
-		bool messyClusters;
 		bool invalidLayout;
+		/// @brief If true, every cluster is solved and every child gets its bounds on next layout,
+		/// otherwise only dirty clusters and the ones depending on them are solved.
+		bool fullLayout;
 		bool canWrapW, canWrapH;//TODO: add updating this values;
 
 		Color backgroundColor;
 
-		float getEdge(Component* c, Constraint::Edge e);
-
-		bool reorderClusters();
+		/// @brief Returns slot of component, allocating new one if it has none.
+		/// Returns @ref noSlot for nullptr.
+		size_t slotOf(const Component* c);
+		void releaseSlot(size_t slot);
+		Rect getSlotBounds(size_t slot) const;
+		void setSlotBounds(size_t slot, const Rect& bounds);
+
+		float getEdge(size_t slot, Constraint::Edge e) const;
+
+		/// @brief Creates empty cluster placed last in order of dependencies.
+		std::list<Cluster>::iterator createCluster();
+		/// @brief Removes cluster, which dependencies were already moved or removed.
+		void eraseCluster(std::list<Cluster>::iterator cluster);
+		/// @brief Adds slot to cluster, clusters already depending on slot are ordered after it.
+		void addComponent(std::list<Cluster>::iterator cluster, size_t slot);
+		/// @brief Makes cluster depend on slot.
+		/// @throws std::logic_error if dependency would create cycle, in which case nothing is changed.
+		void addDependency(Cluster& cluster, size_t slot);
+		void removeDependency(Cluster& cluster, size_t slot);
+		/// @brief Calls visitor for every cluster depending on components of given one.
+		template<typename Visitor>
+		void forEachDependent(const Cluster& cluster, Visitor&& visitor);
+		/// @brief Calls visitor for every cluster given one depends on.
+		template<typename Visitor>
+		void forEachDependency(const Cluster& cluster, Visitor&& visitor);
+		/// @brief Moves target after source in order of dependencies, reordering only clusters between them.
+		/// @throws std::logic_error if target already precedes source, in which case nothing is changed.
+		void orderAfter(Cluster& source, Cluster& target);
+		void compactOrder();
+		static bool isLaterInOrder(const Cluster* a, const Cluster* b);
 
 		void solveConstraint(const Constraint& c, Constraint::PassType pass);
 
+		void markDirty(Cluster& cluster);
 		void solveCluster(const Cluster& cluster);
+		/// @brief Appends bounds of cluster components to @ref solvedBounds.
+		void recordBounds(const Cluster& cluster);
+		/// @brief Marks dependents of solved cluster dirty and records changed slots, comparing with bounds recorded at given offset.
+		void commitCluster(Cluster& cluster, size_t recorded);
+		/// @brief Solves cluster, marks its dependents dirty and records changed slots if its bounds changed.
+		void updateCluster(Cluster& cluster);
+		/// @brief Solves clusters which may need it level by level, each level in parallel.
+		void solveLevels();
 
 		void solveConstraints();
 		void solveConstraints(const DimensionDesc& w, const DimensionDesc& h);
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <guider/base.hpp>
+
+namespace Guider
+{
+	/// @brief Canvas that records drawing calls instead of rendering them.
+	///
+	/// Used by @ref HeadlessBackend for profiling and testing without a display.
+	class RecordingCanvas : public Canvas
+	{
+	public:
+		/// @brief Single recorded call.
+		class Command
+		{
+		public:
+			/// @brief Recorded call type.
+			enum class Type : uint8_t
+			{
+				DrawRectangle,
+				DrawImage,
+				DrawText,
+				SetDrawOrigin,
+				SetBounds,
+				ClearMask,
+				SetupMask,
+				UseMask,
+				DisableMask,
+				PushMaskLayer,
+				PopMaskLayer,
+				AddToMask,
+				/// @brief Recorded for every rect passed to @ref HeadlessBackend::useMaskRects.
+				UseMaskRect,
+				DisableMaskRects
+			};
+
+			Type type;
+			Color color;
+			/// @brief Call area, for SetDrawOrigin only position is used.
+			Rect rect;
+
+			Command(Type t, const Rect& r, const Color& c) : type(t), color(c), rect(r) {}
+		};
+
+		virtual void drawRectangle(const Rect& rect, const Color& color) override;
+
+		/// @brief Appends command to the buffer.
+		void record(Command::Type type, const Rect& rect = Rect(), const Color& color = Color());
+
+		/// @brief Returns recorded commands in order of recording.
+		const std::vector<Command>& getCommands() const noexcept;
+		/// @brief Returns number of recorded commands of given type.
+		size_t count(Command::Type type) const noexcept;
+		/// @brief Clears command buffer.
+		///
+		/// Allocated memory is kept, so recording next frame does not allocate.
+		void clear();
+	private:
+		std::vector<Command> commands;
+	};
+
+	namespace HeadlessResources
+	{
+		class ImageResource : public Guider::Resources::ImageResource
+		{
+		public:
+			virtual void draw(Canvas& canvas, const Rect& bounds) override;
+
+			ImageResource(size_t w, size_t h) : Guider::Resources::ImageResource(w, h) {}
+		};
+
+		class ImageCanvas : public Guider::Resources::ImageCanvas, public RecordingCanvas
+		{
+		public:
+			virtual Guider::Resources::ImageResource& getImage() override;
+
+			virtual void drawRectangle(const Rect& rect, const Color& color) override;
+			/// @brief Clears recorded commands.
+			virtual void clear() override;
+
+			ImageCanvas(size_t width, size_t height) : image(width, height) {}
+		private:
+			ImageResource image;
+		};
+
+		class RectangleShape : public Guider::Resources::RectangleShape
+		{
+		public:
+			virtual void draw(Canvas& canvas, const Rect& bounds) override;
+
+			virtual void setSize(const Vec2& size) override;
+
+			virtual void setColor(const Color& color) override;
+
+			RectangleShape(const Vec2& s, const Color& c) : size(s), color(c) {}
+		private:
+			Vec2 size;
+			Color color;
+		};
+
+		/// @brief Font with fixed metrics.
+		///
+		/// Every character has the same advance, so measurements do not depend on any font file.
+		class FontResource : public Guider::Resources::FontResource
+		{
+		public:
+			virtual float getLineHeight(float textSize) const override;
+			virtual float getLineWidth(float textSize, const std::string& text) const override;
+
+			/// @param advance Character advance relative to text size.
+			/// @param lineSpacing Line height relative to text size.
+			FontResource(float advance = 0.5f, float lineSpacing = 1.25f) : advance(advance), lineSpacing(lineSpacing) {}
+		private:
+			float advance, lineSpacing;
+		};
+
+		class TextResource : public Guider::Resources::TextResource
+		{
+		public:
+			virtual void draw(Canvas& canvas, const Rect& bounds) override;
+			virtual void setText(const std::string& text) override;
+			virtual void setTextSize(float size) override;
+			virtual void setFont(const Guider::Resources::FontResource& font) override;
+			virtual void setColor(const Color& color) override;
+			virtual float getLineHeight() const override;
+			virtual float getLineWidth() const override;
+
+			TextResource() : font(nullptr), textSize(0) {}
+		private:
+			std::string text;
+			const Guider::Resources::FontResource* font;
+			float textSize;
+			Color color;
+		};
+	}
+
+	/// @brief Backend that does not need display or gpu.
+	///
+	/// Every drawing, masking and clipping call is recorded into @ref RecordingCanvas,
+	/// fonts have deterministic metrics and image files are never read.
+	class HeadlessBackend : public Backend
+	{
+	public:
+		virtual void setDrawOrigin(float x, float y) override;
+
+		virtual void clearMask() override;
+		virtual void setupMask() override;
+		virtual void useMask() override;
+		virtual void disableMask() override;
+		virtual void pushMaskLayer() override;
+		virtual void popMaskLayer() override;
+		virtual void addToMask(const Rect& rect) override;
+		virtual void useMaskRects(const std::vector<Rect>& rects) override;
+		virtual void disableMaskRects() override;
+
+		virtual std::shared_ptr<Canvas> getCanvas() override;
+		virtual void setBounds(const Rect& rect) override;
+		/// @brief Further origin and bounds changes are recorded into layer canvas.
+		virtual void setLayer(Resources::ImageCanvas* layer) override;
+
+		virtual Vec2 getSize() const noexcept override;
+		virtual void setSize(const Vec2& size) override;
+
+		virtual std::shared_ptr<Resources::RectangleShape> createRectangle(const Vec2& size, const Color& color) override;
+		virtual std::shared_ptr<Resources::TextResource> createText(const std::string& text, const Resources::FontResource& font, float size, const Color& color) override;
+		/// @brief Returns font with given name.
+		///
+		/// Unknown names are resolved to default font, so components never end up without font.
+		virtual std::shared_ptr<Resources::FontResource> getFontByName(const std::string& name) override;
+		/// @brief Registers font with default metrics under given name, file is not read.
+		virtual std::shared_ptr<Resources::FontResource> loadFontFromFile(const std::string& filename, const std::string& name) override;
+		/// @brief Creates empty image, file is not read.
+		virtual std::shared_ptr<Resources::ImageResource> loadImageFromFile(const std::string& filename) override;
+		virtual std::shared_ptr<Resources::ImageCanvas> createImage(const Vec2& size) override;
+		virtual void deleteResource(Resources::Resource& resource) override;
+
+		/// @brief Returns canvas with recorded commands.
+		inline RecordingCanvas& getRecordingCanvas()
+		{
+			return *canvas;
+		}
+
+		HeadlessBackend(const Vec2& size);
+	private:
+		std::shared_ptr<RecordingCanvas> canvas;
+		RecordingCanvas* current;
+		std::shared_ptr<HeadlessResources::FontResource> defaultFont;
+		std::unordered_map<std::string, std::shared_ptr<HeadlessResources::FontResource>> fonts;
+		Vec2 size;
+	};
+}
\ No newline at end of file
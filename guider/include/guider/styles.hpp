@@ -1,6 +1,6 @@
 #pragma once
 
-#include <Guider/base.hpp>
+#include <guider/base.hpp>
 #include <unordered_map>
 #include <functional>
 #include <typeindex>
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+namespace Guider
+{
+	/// @brief Fixed set of worker threads running batches of independent tasks.
+	///
+	/// Calling thread takes part in every batch. Batch started from a running task, of any pool,
+	/// is run serially by the calling thread, so nested batches never wait for busy workers.
+	class ThreadPool
+	{
+	public:
+		using Task = std::function<void(size_t)>;
+
+		/// @brief Calls task for every index below count and returns when all calls finished.
+		///
+		/// Calls are spread over threads in unspecified order, one batch is run at a time.
+		/// @throws Exception thrown by the call with lowest index, after all calls finished.
+		void run(size_t count, const Task& task);
+
+		/// @brief Returns number of threads running a batch, including the calling one.
+		size_t getConcurrency() const noexcept;
+
+		/// @brief Returns true if called from task run by any pool.
+		static bool isRunningTask() noexcept;
+
+		/// @param workers Number of worker threads, besides the calling one.
+		ThreadPool(size_t workers);
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+		~ThreadPool();
+	private:
+		std::vector<std::thread> workers;
+		std::mutex mutex;
+		std::condition_variable started, finished;
+
+		const Task* task;
+		size_t count;
+		std::atomic<size_t> next;
+		/// @brief Number of workers which did not finish current batch yet.
+		size_t running;
+		uint64_t batch;
+		bool stopping;
+		size_t errorIndex;
+		std::exception_ptr error;
+
+		void work();
+		/// @brief Runs calls of current batch until none is left.
+		void runTasks();
+		void stop();
+	};
+}
\ No newline at end of file
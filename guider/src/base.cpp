@@ -1,5 +1,9 @@
 #include <guider/base.hpp>
-#include <climits>
+#include <guider/thread_pool.hpp>
+#include <limits>
+#include <cmath>
+#include <cassert>
+#include <algorithm>
 
 namespace Guider
 {
@@ -138,6 +142,312 @@ namespace Guider
 	}
 
 
+	void Region::appendBand(float top, float bottom, const std::vector<Span>& s)
+	{
+		if (s.empty())
+			return;
+		if (!bands.empty())
+		{
+			//merge with previous band if it touches and has the same spans
+			Band& last = bands.back();
+			if (last.bottom == top && last.end - last.begin == s.size() &&
+				std::equal(s.begin(), s.end(), spans.begin() + last.begin, [](const Span& a, const Span& b) {
+					return a.left == b.left && a.right == b.right;
+				}))
+			{
+				last.bottom = bottom;
+				return;
+			}
+		}
+		Band band;
+		band.top = top;
+		band.bottom = bottom;
+		band.begin = spans.size();
+		spans.insert(spans.end(), s.begin(), s.end());
+		band.end = spans.size();
+		bands.push_back(band);
+	}
+
+	Region Region::combine(const Region& a, const Region& b, Operation op)
+	{
+		auto keep = [op](bool inA, bool inB) {
+			switch (op)
+			{
+			case Operation::Union:
+				return inA || inB;
+			case Operation::Intersection:
+				return inA && inB;
+			default:
+				return inA && !inB;
+			}
+		};
+
+		Region ret;
+		std::vector<Span> result;
+		size_t ia = 0, ib = 0;
+		float y = std::numeric_limits<float>::lowest();
+		while (ia < a.bands.size() || ib < b.bands.size())
+		{
+			//skip bands that end above current position
+			while (ia < a.bands.size() && a.bands[ia].bottom <= y)
+				++ia;
+			while (ib < b.bands.size() && b.bands[ib].bottom <= y)
+				++ib;
+			const Band* ba = ia < a.bands.size() ? &a.bands[ia] : nullptr;
+			const Band* bb = ib < b.bands.size() ? &b.bands[ib] : nullptr;
+			if (ba == nullptr && bb == nullptr)
+				break;
+
+			//find next horizontal strip where set of covering bands does not change
+			float top = std::numeric_limits<float>::max();
+			if (ba != nullptr)
+				top = std::min(top, std::max(ba->top, y));
+			if (bb != nullptr)
+				top = std::min(top, std::max(bb->top, y));
+			bool coverA = ba != nullptr && ba->top <= top;
+			bool coverB = bb != nullptr && bb->top <= top;
+			float bottom = std::numeric_limits<float>::max();
+			if (ba != nullptr)
+				bottom = std::min(bottom, coverA ? ba->bottom : ba->top);
+			if (bb != nullptr)
+				bottom = std::min(bottom, coverB ? bb->bottom : bb->top);
+			y = bottom;
+
+			//sweep through span edges of both bands
+			result.clear();
+			size_t sa = coverA ? ba->begin : 0, ea = coverA ? ba->end : 0;
+			size_t sb = coverB ? bb->begin : 0, eb = coverB ? bb->end : 0;
+			bool inA = false, inB = false, inside = false;
+			float start = 0;
+			while (sa < ea || sb < eb)
+			{
+				float xa = sa < ea ? (inA ? a.spans[sa].right : a.spans[sa].left) : std::numeric_limits<float>::max();
+				float xb = sb < eb ? (inB ? b.spans[sb].right : b.spans[sb].left) : std::numeric_limits<float>::max();
+				float x = std::min(xa, xb);
+				if (xa == x)
+				{
+					if (inA)
+						++sa;
+					inA = !inA;
+				}
+				if (xb == x)
+				{
+					if (inB)
+						++sb;
+					inB = !inB;
+				}
+				bool now = keep(inA, inB);
+				if (now && !inside)
+				{
+					start = x;
+				}
+				else if (!now && inside && x > start)
+				{
+					if (!result.empty() && result.back().right == start)
+						result.back().right = x;
+					else
+						result.push_back(Span{ start, x });
+				}
+				inside = now;
+			}
+			ret.appendBand(top, bottom, result);
+		}
+		return ret;
+	}
+
+	void Region::build(const std::vector<Rect>& rects)
+	{
+		std::vector<float> ys;
+		std::vector<const Rect*> pending;
+		ys.reserve(rects.size() * 2);
+		pending.reserve(rects.size());
+		for (const Rect& r : rects)
+		{
+			if (r.width > 0 && r.height > 0)
+			{
+				ys.push_back(r.top);
+				ys.push_back(r.top + r.height);
+				pending.push_back(&r);
+			}
+		}
+		std::sort(ys.begin(), ys.end());
+		ys.erase(std::unique(ys.begin(), ys.end()), ys.end());
+		std::sort(pending.begin(), pending.end(), [](const Rect* a, const Rect* b) {
+			return a->top < b->top;
+		});
+
+		//sweep horizontal strips between consecutive edges, keeping rects that cover current strip
+		std::vector<const Rect*> active;
+		std::vector<Span> strip, merged;
+		size_t next = 0;
+		for (size_t i = 0; i + 1 < ys.size(); ++i)
+		{
+			float top = ys[i], bottom = ys[i + 1];
+			active.erase(std::remove_if(active.begin(), active.end(), [top](const Rect* r) {
+				return r->top + r->height <= top;
+			}), active.end());
+			while (next < pending.size() && pending[next]->top <= top)
+				active.push_back(pending[next++]);
+
+			strip.clear();
+			for (const Rect* r : active)
+				strip.push_back(Span{ r->left, r->left + r->width });
+			std::sort(strip.begin(), strip.end(), [](const Span& a, const Span& b) {
+				return a.left < b.left;
+			});
+			merged.clear();
+			for (const Span& span : strip)
+			{
+				if (!merged.empty() && span.left <= merged.back().right)
+					merged.back().right = std::max(merged.back().right, span.right);
+				else
+					merged.push_back(span);
+			}
+			appendBand(top, bottom, merged);
+		}
+	}
+
+	Region& Region::unite(const Rect& rect)
+	{
+		return unite(Region(rect));
+	}
+
+	Region& Region::unite(const Region& region)
+	{
+		if (region.isEmpty())
+			return *this;
+		if (isEmpty())
+			return *this = region;
+		*this = combine(*this, region, Operation::Union);
+		return *this;
+	}
+
+	Region& Region::intersect(const Rect& rect)
+	{
+		return intersect(Region(rect));
+	}
+
+	Region& Region::intersect(const Region& region)
+	{
+		*this = combine(*this, region, Operation::Intersection);
+		return *this;
+	}
+
+	Region& Region::subtract(const Rect& rect)
+	{
+		return subtract(Region(rect));
+	}
+
+	Region& Region::subtract(const Region& region)
+	{
+		if (region.isEmpty() || isEmpty())
+			return *this;
+		*this = combine(*this, region, Operation::Difference);
+		return *this;
+	}
+
+	void Region::clear()
+	{
+		bands.clear();
+		spans.clear();
+	}
+
+	bool Region::isEmpty() const noexcept
+	{
+		return bands.empty();
+	}
+
+	bool Region::contains(const Vec2& point) const noexcept
+	{
+		for (const Band& band : bands)
+		{
+			if (band.top <= point.y && band.bottom > point.y)
+			{
+				for (size_t i = band.begin; i < band.end; ++i)
+					if (spans[i].left <= point.x && spans[i].right > point.x)
+						return true;
+				return false;
+			}
+		}
+		return false;
+	}
+
+	bool Region::intersects(const Rect& rect) const noexcept
+	{
+		float right = rect.left + rect.width, bottom = rect.top + rect.height;
+		for (const Band& band : bands)
+		{
+			if (band.bottom <= rect.top || band.top >= bottom)
+				continue;
+			for (size_t i = band.begin; i < band.end; ++i)
+				if (spans[i].left < right && spans[i].right > rect.left)
+					return true;
+		}
+		return false;
+	}
+
+	Rect Region::getBounds() const noexcept
+	{
+		if (bands.empty())
+			return Rect();
+		float left = std::numeric_limits<float>::max(), right = std::numeric_limits<float>::lowest();
+		for (const Band& band : bands)
+		{
+			left = std::min(left, spans[band.begin].left);
+			right = std::max(right, spans[band.end - 1].right);
+		}
+		return Rect(left, bands.front().top, right - left, bands.back().bottom - bands.front().top);
+	}
+
+	std::vector<Rect> Region::getRects() const
+	{
+		std::vector<Rect> ret;
+		ret.reserve(spans.size());
+		for (const Band& band : bands)
+			for (size_t i = band.begin; i < band.end; ++i)
+				ret.emplace_back(spans[i].left, band.top, spans[i].right - spans[i].left, band.bottom - band.top);
+		return ret;
+	}
+
+	size_t Region::getRectCount() const noexcept
+	{
+		return spans.size();
+	}
+
+	bool Region::operator==(const Region& region) const noexcept
+	{
+		if (bands.size() != region.bands.size() || spans.size() != region.spans.size())
+			return false;
+		for (size_t i = 0; i < bands.size(); ++i)
+			if (bands[i].top != region.bands[i].top || bands[i].bottom != region.bands[i].bottom || bands[i].end != region.bands[i].end)
+				return false;
+		for (size_t i = 0; i < spans.size(); ++i)
+			if (spans[i].left != region.spans[i].left || spans[i].right != region.spans[i].right)
+				return false;
+		return true;
+	}
+
+	bool Region::operator!=(const Region& region) const noexcept
+	{
+		return !(*this == region);
+	}
+
+	Region::Region()
+	{
+	}
+
+	Region::Region(const Rect& rect)
+	{
+		if (rect.width > 0 && rect.height > 0)
+			appendBand(rect.top, rect.top + rect.height, { Span{ rect.left, rect.left + rect.width } });
+	}
+
+	Region::Region(const std::vector<Rect>& rects)
+	{
+		build(rects);
+	}
+
+
 	bool Color::operator==(const Color& color) const noexcept
 	{
 		return value == color.value;
@@ -246,6 +556,74 @@ namespace Guider
 		drawable.draw(*this, bounds);
 	}
 
+	Canvas& Canvas::getRenderingCanvas()
+	{
+		return *this;
+	}
+
+	void DisplayList::drawRectangle(const Rect& rect, const Color& color)
+	{
+		commands.emplace_back(nullptr, rect, color);
+		target->drawRectangle(rect, color);
+	}
+
+	void DisplayList::draw(Resources::Drawable& drawable, const Rect& rect)
+	{
+		commands.emplace_back(&drawable, rect, Color());
+		target->draw(drawable, rect);
+	}
+
+	Canvas& DisplayList::getRenderingCanvas()
+	{
+		if (target == nullptr)
+			throw std::logic_error("display list is not recording");
+		return target->getRenderingCanvas();
+	}
+
+	void DisplayList::begin(Canvas& t)
+	{
+		commands.clear();
+		recorded = false;
+		target = &t;
+	}
+
+	void DisplayList::end()
+	{
+		target = nullptr;
+		recorded = true;
+	}
+
+	void DisplayList::replay(Canvas& canvas) const
+	{
+		for (const Command& c : commands)
+		{
+			if (c.drawable != nullptr)
+				canvas.draw(*c.drawable, c.rect);
+			else
+				canvas.drawRectangle(c.rect, c.color);
+		}
+	}
+
+	void DisplayList::clear()
+	{
+		commands.clear();
+		recorded = false;
+	}
+
+	bool DisplayList::isRecorded() const noexcept
+	{
+		return recorded;
+	}
+
+	size_t DisplayList::getCommandCount() const noexcept
+	{
+		return commands.size();
+	}
+
+	DisplayList::DisplayList() : target(nullptr), recorded(false)
+	{
+	}
+
 
 	void Backend::pushDrawOffset(const Vec2& offset)
 	{
@@ -253,7 +631,7 @@ namespace Guider
 		if (!offsets.empty())
 			pos += offsets.back();
 		offsets.emplace_back(pos);
-		setDrawOrigin(pos.x, pos.y);
+		applyDrawOrigin(pos);
 	}
 	
 	Vec2 Backend::getDrawOffset() const
@@ -266,20 +644,156 @@ namespace Guider
 	void Backend::popDrawOffset()
 	{
 		offsets.pop_back();
-		Vec2 cpos = getDrawOffset();
-		setDrawOrigin(cpos.x, cpos.y);
+		applyDrawOrigin(getDrawOffset());
 	}
 
 	void Backend::pushBounds(const Rect& rect)
 	{
 		bounds.push_back(rect.at(getDrawOffset()).limit(getBounds()));
-		setBounds(bounds.back());
+		applyBounds(bounds.back());
 	}
 
 	void Backend::popBounds()
 	{
 		bounds.pop_back();
-		setBounds(getBounds());
+		applyBounds(getBounds());
+	}
+
+	void Backend::resetState()
+	{
+		originApplied = false;
+		boundsApplied = false;
+	}
+
+	void Backend::pushLayer(Resources::ImageCanvas& layer, const Vec2& size)
+	{
+		//switched first, so backend without layers throws before state changes
+		setLayer(&layer);
+
+		LayerState state;
+		state.layer = &layer;
+		state.offsets.swap(offsets);
+		state.bounds.swap(bounds);
+		layers.push_back(std::move(state));
+
+		bounds.emplace_back(0.f, 0.f, size.x, size.y);
+		resetState();
+		applyDrawOrigin(getDrawOffset());
+		applyBounds(getBounds());
+	}
+
+	void Backend::setLayer(Resources::ImageCanvas* layer)
+	{
+		if (layer != nullptr)
+			throw std::logic_error("backend does not support layers");
+	}
+
+	void Backend::popLayer()
+	{
+		LayerState& state = layers.back();
+		offsets.swap(state.offsets);
+		bounds.swap(state.bounds);
+		layers.pop_back();
+
+		setLayer(layers.empty() ? nullptr : layers.back().layer);
+		resetState();
+		applyDrawOrigin(getDrawOffset());
+		applyBounds(getBounds());
+	}
+
+	void Backend::applyDrawOrigin(const Vec2& origin)
+	{
+		if (originApplied && appliedOrigin.x == origin.x && appliedOrigin.y == origin.y)
+			return;
+		appliedOrigin = origin;
+		originApplied = true;
+		setDrawOrigin(origin.x, origin.y);
+	}
+
+	void Backend::applyBounds(const Rect& rect)
+	{
+		if (boundsApplied && appliedBounds == rect)
+			return;
+		appliedBounds = rect;
+		boundsApplied = true;
+		setBounds(rect);
+	}
+
+	void Backend::setMaskMode(MaskMode mode)
+	{
+		maskMode = mode;
+	}
+
+	Backend::MaskMode Backend::getMaskMode() const noexcept
+	{
+		return maskMode;
+	}
+
+	void Backend::applyMask(const Region& mask)
+	{
+		maskRects = maskMode == MaskMode::Scissor || (maskMode == MaskMode::Auto && mask.getRectCount() <= 1);
+		if (maskRects)
+		{
+			useMaskRects(mask.getRects());
+		}
+		else
+		{
+			setupMask();
+			clearMask();
+			for (const Rect& r : mask.getRects())
+				addToMask(r);
+			useMask();
+		}
+	}
+
+	void Backend::useMaskRects(const std::vector<Rect>& rects)
+	{
+		setupMask();
+		clearMask();
+		for (const Rect& r : rects)
+			addToMask(r);
+		useMask();
+	}
+
+	void Backend::disableMaskRects()
+	{
+		clearMask();
+		disableMask();
+	}
+
+	void Backend::releaseMask()
+	{
+		if (maskRects)
+			disableMaskRects();
+		else
+			disableMask();
+	}
+
+	void Backend::addDamagedRect(const Rect& rect)
+	{
+		Rect global = (rect + getDrawOffset()).limit(getBounds());
+		if (global.width > 0 && global.height > 0)
+			damagedRects.push_back(global);
+	}
+
+	const Region& Backend::getDamage()
+	{
+		if (!damagedRects.empty())
+		{
+			damage.unite(Region(damagedRects));
+			damagedRects.clear();
+		}
+		return damage;
+	}
+
+	void Backend::resetDamage()
+	{
+		damagedRects.clear();
+		damage.clear();
+	}
+
+	Backend::Backend() : maskMode(MaskMode::Auto), maskRects(false), originApplied(false), boundsApplied(false)
+	{
 	}
 
 	Rect Backend::getBounds() const
@@ -293,6 +807,11 @@ namespace Guider
 
 	namespace Resources
 	{
+		void ImageCanvas::clear()
+		{
+			throw std::logic_error("image canvas does not support clearing");
+		}
+
 		void CompositeDrawable::draw(Canvas& canvas, const Rect& bounds)
 		{
 			for (auto& sub : elements)
@@ -578,6 +1097,10 @@ namespace Guider
 	{
 	}
 
+	void Component::onChildResize(Component& c, const Rect& lastBounds)
+	{
+	}
+
 	bool Component::handleEvent(const Event& event)
 	{
 		switch (event.type)
@@ -585,6 +1108,11 @@ namespace Guider
 		case Event::Type::BackendConnected:
 		{
 			backend = &event.backendConnected.backend;
+			//recorded drawables and layer belong to previous backend
+			if (displayList)
+				displayList->clear();
+			layer.reset();
+			layerValid = false;
 			invalidate();
 			break;
 		}
@@ -635,6 +1163,11 @@ namespace Guider
 
 	void Component::invalidate()
 	{
+		//components measured by pool threads must not change the tree, see ConstraintsContainer::setThreadPool
+		assert(!ThreadPool::isRunningTask());
+		measureCache.clear();
+		if (displayList)
+			displayList->clear();
 		if (clean)
 		{
 			clean = false;
@@ -645,13 +1178,38 @@ namespace Guider
 			if (p != nullptr)
 			{
 				p->onChildStain(*c);
-				p->invalidate();
+				p->stain();
 			}
 			invalidateVisuals();
 		}
 	}
 
+	void Component::stain()
+	{
+		assert(!ThreadPool::isRunningTask());
+		measureCache.clear();
+		if (clean)
+		{
+			clean = false;
+
+			//visuals are kept, layout pass requests redraw of children it moves
+			if (parent != nullptr)
+			{
+				parent->onChildStain(*this);
+				parent->stain();
+			}
+		}
+	}
+
 	void Component::invalidateVisuals()
+	{
+		if (displayList)
+			displayList->clear();
+		invalidateLayers();
+		requestRedraw();
+	}
+
+	void Component::requestRedraw()
 	{
 		if (!toRedraw)
 		{
@@ -660,10 +1218,12 @@ namespace Guider
 			Component* p = getParent();
 			Component* c = this;
 
+			//parent only needs to know about this child, containers overriding
+			//requestRedraw would request redraw of all siblings
 			if (p != nullptr)
 			{
 				p->onChildNeedsRedraw(*c);
-				p->invalidateVisuals();
+				p->Component::requestRedraw();
 			}
 		}
 	}
@@ -678,7 +1238,69 @@ namespace Guider
 		handleEvent(Event::createVisualsInvalidatedEvent());
 	}
 
+	std::atomic<size_t> Component::measureCacheHits(0);
+	std::atomic<size_t> Component::measureCacheMisses(0);
+
 	std::pair<Component::DimensionDesc, Component::DimensionDesc> Component::measure(const DimensionDesc& width, const DimensionDesc& height)
+	{
+		if (!measureCacheEnabled)
+			return onMeasure(width, height);
+
+		Vec2 parentSize;
+		if (parent != nullptr)
+		{
+			Rect pbounds = parent->getBounds();
+			parentSize = Vec2(pbounds.width, pbounds.height);
+		}
+
+		for (const auto& entry : measureCache)
+		{
+			if (entry.width.value == width.value && entry.width.mode == width.mode &&
+				entry.height.value == height.value && entry.height.mode == height.mode &&
+				entry.parentSize.x == parentSize.x && entry.parentSize.y == parentSize.y)
+			{
+				measureCacheHits.fetch_add(1, std::memory_order_relaxed);
+				return entry.result;
+			}
+		}
+
+		measureCacheMisses.fetch_add(1, std::memory_order_relaxed);
+		MeasureCacheEntry entry{ width, height, parentSize, onMeasure(width, height) };
+		if (measureCache.size() < measureCacheSize)
+		{
+			measureCache.push_back(entry);
+		}
+		else
+		{
+			measureCache[measureCacheNext] = entry;
+			measureCacheNext = (measureCacheNext + 1) % measureCacheSize;
+		}
+		return entry.result;
+	}
+
+	size_t Component::getMeasureCacheHits() noexcept
+	{
+		return measureCacheHits.load(std::memory_order_relaxed);
+	}
+
+	size_t Component::getMeasureCacheMisses() noexcept
+	{
+		return measureCacheMisses.load(std::memory_order_relaxed);
+	}
+
+	void Component::resetMeasureCacheStats() noexcept
+	{
+		measureCacheHits.store(0, std::memory_order_relaxed);
+		measureCacheMisses.store(0, std::memory_order_relaxed);
+	}
+
+	void Component::disableMeasureCache()
+	{
+		measureCacheEnabled = false;
+		measureCache.clear();
+	}
+
+	std::pair<Component::DimensionDesc, Component::DimensionDesc> Component::onMeasure(const DimensionDesc& width, const DimensionDesc& height)
 	{
 		float w = 0, h = 0;
 		Rect pbounds;
@@ -764,7 +1386,7 @@ namespace Guider
 	
 	void Component::onMaskDraw(Canvas& canvas) const
 	{
-		getBackend()->addToMask(bounds.at(Vec2(0.f, 0.f)));
+		getBackend()->addDamagedRect(bounds.at(Vec2(0.f, 0.f)));
 	}
 	
 	void Component::onRedraw(Canvas& canvas)
@@ -776,7 +1398,11 @@ namespace Guider
 	{
 		getBackend()->pushDrawOffset(Vec2(bounds.left, bounds.top));
 		getBackend()->pushBounds(bounds.at({ 0.f, 0.f }));
-		onMaskDraw(canvas);
+		//layer is drawn as a whole
+		if (cacheAsLayer)
+			Component::onMaskDraw(canvas);
+		else
+			onMaskDraw(canvas);
 		getBackend()->popBounds();
 		getBackend()->popDrawOffset();
 	}
@@ -786,7 +1412,12 @@ namespace Guider
 		toRedraw = false;
 		getBackend()->pushDrawOffset(Vec2(bounds.left, bounds.top));
 		getBackend()->pushBounds(bounds.at(Vec2(0, 0)));
-		onDraw(canvas);
+		if (cacheAsLayer)
+			drawLayer(canvas);
+		else if (displayList)
+			drawRetained(canvas);
+		else
+			onDraw(canvas);
 		getBackend()->popBounds();
 		getBackend()->popDrawOffset();
 	}
@@ -796,11 +1427,93 @@ namespace Guider
 		toRedraw = false;
 		getBackend()->pushDrawOffset(Vec2(bounds.left, bounds.top));
 		getBackend()->pushBounds(bounds.at(Vec2(0, 0)));
-		onRedraw(canvas);
+		if (cacheAsLayer)
+			drawLayer(canvas);
+		else if (displayList)
+			drawRetained(canvas);
+		else
+			onRedraw(canvas);
 		getBackend()->popBounds();
 		getBackend()->popDrawOffset();
 	}
 
+	void Component::setCacheAsLayer(bool cache)
+	{
+		cacheAsLayer = cache;
+		layer.reset();
+		layerValid = false;
+		invalidateVisuals();
+	}
+
+	bool Component::isCachedAsLayer() const noexcept
+	{
+		return cacheAsLayer;
+	}
+
+	void Component::setRetained(bool retained)
+	{
+		if (!retained)
+			displayList.reset();
+		else if (!displayList)
+			displayList = std::make_unique<DisplayList>();
+	}
+
+	bool Component::isRetained() const noexcept
+	{
+		return displayList != nullptr;
+	}
+
+	void Component::drawLayer(Canvas& canvas)
+	{
+		Vec2 size(bounds.width, bounds.height);
+		if (size.x <= 0 || size.y <= 0)
+			return;
+
+		if (!layer || layerSize.x != size.x || layerSize.y != size.y)
+		{
+			layer = getBackend()->createImage(size);
+			layerSize = size;
+			layerValid = false;
+		}
+		if (!layerValid)
+		{
+			layer->clear();
+			getBackend()->pushLayer(*layer, size);
+			onRedraw(*layer);
+			getBackend()->popLayer();
+			layerValid = true;
+		}
+		canvas.draw(layer->getImage(), Rect(0.f, 0.f, size.x, size.y));
+	}
+
+	void Component::invalidateLayers()
+	{
+		for (Component* c = this; c != nullptr; c = c->parent)
+		{
+			if (c->cacheAsLayer && c->layerValid)
+			{
+				c->layerValid = false;
+				//redraw flags inside cached subtree are not reset, so they cannot be relied on
+				c->requestRedraw();
+			}
+		}
+	}
+
+	void Component::drawRetained(Canvas& canvas)
+	{
+		if (displayList->isRecorded())
+		{
+			displayList->replay(canvas);
+		}
+		else
+		{
+			//recording is always complete drawing, so it can be replayed in place of both draw and redraw
+			displayList->begin(canvas);
+			onRedraw(*displayList);
+			displayList->end();
+		}
+	}
+
 	std::function<bool(const Event&)> Component::setOnEventCallback(const std::function<bool(const Event&)>& callback)
 	{
 		auto lf = eventCallback;
@@ -808,7 +1521,7 @@ namespace Guider
 		return lf;
 	}
 
-	Component::Component() :backend(nullptr), parent(nullptr), toRedraw(true), clean(false), hasMouseOver(false), hasMouseFocus(false), sizingModeH(SizingMode::OwnSize), sizingModeW(SizingMode::OwnSize), width(0), height(0)
+	Component::Component() :backend(nullptr), parent(nullptr), clean(false), toRedraw(true), dirtyStamps{ 0, 0 }, hasMouseOver(false), hasMouseFocus(false), sizingModeW(SizingMode::OwnSize), sizingModeH(SizingMode::OwnSize), width(0), height(0), measureCacheEnabled(true), measureCacheNext(0), cacheAsLayer(false), layerValid(false)
 	{
 	}
 
@@ -817,6 +1530,16 @@ namespace Guider
 		Rect lastBounds = c.bounds;
 		c.bounds = r;
 		c.onResize(lastBounds);
+		if (c.parent != nullptr)
+			c.parent->onChildResize(c, lastBounds);
+	}
+
+	void Component::moveBounds(Component& c, const Rect& r) const
+	{
+		Rect lastBounds = c.bounds;
+		c.bounds = r;
+		if (c.parent != nullptr)
+			c.parent->onChildResize(c, lastBounds);
 	}
 
 	void Component::setClean()
@@ -845,25 +1568,397 @@ namespace Guider
 	}
 
 
-	void Container::invalidateVisuals()
+	uint64_t SpatialIndex::cellKey(int32_t x, int32_t y)
+	{
+		return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+	}
+
+	int32_t SpatialIndex::cellIndex(float v, bool& inRange) const
+	{
+		//range is small enough for cell counts to never overflow
+		const double limit = static_cast<double>(1 << 30);
+		double cell = std::floor(static_cast<double>(v) / cellSize);
+		if (cell >= -limit && cell <= limit)
+			return static_cast<int32_t>(cell);
+		inRange = false;
+		return cell < 0 ? -(1 << 30) : (1 << 30);
+	}
+
+	bool SpatialIndex::cellRange(const Rect& bounds, int32_t& x0, int32_t& y0, int32_t& x1, int32_t& y1) const
+	{
+		bool inRange = true;
+		x0 = cellIndex(bounds.left, inRange);
+		y0 = cellIndex(bounds.top, inRange);
+		x1 = cellIndex(bounds.left + bounds.width, inRange);
+		y1 = cellIndex(bounds.top + bounds.height, inRange);
+		return inRange && (static_cast<int64_t>(x1) - x0 + 1) * (static_cast<int64_t>(y1) - y0 + 1) <= static_cast<int64_t>(maxCellsPerItem);
+	}
+
+	void SpatialIndex::insert(const Component& c, const Entry& e)
+	{
+		//empty rect can not contain any point
+		if (e.bounds.width <= 0 || e.bounds.height <= 0)
+			return;
+		Component* ptr = const_cast<Component*>(&c);
+		if (e.large)
+		{
+			large.emplace_back(e.key, ptr);
+			return;
+		}
+		int32_t x0, y0, x1, y1;
+		cellRange(e.bounds, x0, y0, x1, y1);
+		for (int32_t x = x0; x <= x1; ++x)
+			for (int32_t y = y0; y <= y1; ++y)
+				cells[cellKey(x, y)].emplace_back(e.key, ptr);
+	}
+
+	void SpatialIndex::erase(const Component& c, const Entry& e)
+	{
+		if (e.bounds.width <= 0 || e.bounds.height <= 0)
+			return;
+		auto pred = [&c](const Item& i) {
+			return i.component == &c;
+		};
+		if (e.large)
+		{
+			large.erase(std::remove_if(large.begin(), large.end(), pred), large.end());
+			return;
+		}
+		int32_t x0, y0, x1, y1;
+		cellRange(e.bounds, x0, y0, x1, y1);
+		for (int32_t x = x0; x <= x1; ++x)
+		{
+			for (int32_t y = y0; y <= y1; ++y)
+			{
+				auto it = cells.find(cellKey(x, y));
+				if (it != cells.end())
+				{
+					std::vector<Item>& items = it->second;
+					items.erase(std::remove_if(items.begin(), items.end(), pred), items.end());
+					if (items.empty())
+						cells.erase(it);
+				}
+			}
+		}
+	}
+
+	void SpatialIndex::update(Component& c, const Rect& bounds)
+	{
+		int32_t x0, y0, x1, y1;
+		auto it = entries.find(&c);
+		if (it == entries.end())
+		{
+			Entry e{ bounds, nextKey++, !cellRange(bounds, x0, y0, x1, y1) };
+			entries.emplace(&c, e);
+			insert(c, e);
+			return;
+		}
+
+		Entry& e = it->second;
+		if (e.bounds == bounds)
+			return;
+		erase(c, e);
+		e.bounds = bounds;
+		e.large = !cellRange(bounds, x0, y0, x1, y1);
+		insert(c, e);
+	}
+
+	void SpatialIndex::remove(Component& c)
 	{
-		Component::invalidateVisuals();
-		auto it = firstElement();
-		while (!it.end())
+		auto it = entries.find(&c);
+		if (it != entries.end())
 		{
-			it.current().invalidateVisuals();
-			it.loadNext();
+			erase(c, it->second);
+			entries.erase(it);
+		}
+	}
+
+	void SpatialIndex::clear()
+	{
+		entries.clear();
+		cells.clear();
+		large.clear();
+		nextKey = 0;
+	}
+
+	size_t SpatialIndex::getKey(const Component& c) const
+	{
+		return entries.at(&c).key;
+	}
+
+	size_t SpatialIndex::size() const noexcept
+	{
+		return entries.size();
+	}
+
+	void SpatialIndex::query(const Vec2& point, std::vector<Item>& out) const
+	{
+		bool inRange = true;
+		int32_t x = cellIndex(point.x, inRange);
+		int32_t y = cellIndex(point.y, inRange);
+		auto it = inRange ? cells.find(cellKey(x, y)) : cells.end();
+		if (it != cells.end())
+		{
+			for (const Item& i : it->second)
+				if (entries.at(i.component).bounds.contains(point))
+					out.push_back(i);
+		}
+		for (const Item& i : large)
+			if (entries.at(i.component).bounds.contains(point))
+				out.push_back(i);
+	}
+
+	void SpatialIndex::query(const Rect& rect, std::vector<Item>& out) const
+	{
+		auto test = [this, &rect, &out](const Item& i) {
+			if (entries.at(i.component).bounds.intersects(rect))
+				out.push_back(i);
+		};
+		int32_t x0, y0, x1, y1;
+		cellRange(rect, x0, y0, x1, y1);
+		//rect covering more cells than exist is tested against occupied cells only
+		if ((static_cast<int64_t>(x1) - x0 + 1) * (static_cast<int64_t>(y1) - y0 + 1) > static_cast<int64_t>(cells.size()))
+		{
+			for (const auto& cell : cells)
+				for (const Item& i : cell.second)
+					test(i);
+		}
+		else
+		{
+			for (int32_t x = x0; x <= x1; ++x)
+			{
+				for (int32_t y = y0; y <= y1; ++y)
+				{
+					auto it = cells.find(cellKey(x, y));
+					if (it != cells.end())
+						for (const Item& i : it->second)
+							test(i);
+				}
+			}
 		}
+		for (const Item& i : large)
+			test(i);
+	}
+
+	SpatialIndex::SpatialIndex(float cs) : cellSize(cs), nextKey(0)
+	{
+	}
+
+	std::atomic<uint64_t> DirtyList::lastGeneration(0);
+
+	bool DirtyList::insert(Component* c)
+	{
+		uint64_t& stamp = c->dirtyStamps[static_cast<size_t>(kind)];
+		if (stamp == generation)
+			return false;
+		stamp = generation;
+		items.push_back(c);
+		return true;
+	}
+
+	void DirtyList::erase(Component* c)
+	{
+		if (!contains(c))
+			return;
+		c->dirtyStamps[static_cast<size_t>(kind)] = 0;
+		items.erase(std::find(items.begin(), items.end(), c));
+	}
+
+	bool DirtyList::contains(const Component* c) const noexcept
+	{
+		return c->dirtyStamps[static_cast<size_t>(kind)] == generation;
+	}
+
+	void DirtyList::clear() noexcept
+	{
+		items.clear();
+		generation = ++lastGeneration;
+	}
+
+	bool DirtyList::empty() const noexcept
+	{
+		return items.empty();
+	}
+
+	size_t DirtyList::size() const noexcept
+	{
+		return items.size();
+	}
+
+	DirtyList::const_iterator DirtyList::begin() const noexcept
+	{
+		return items.begin();
+	}
+
+	DirtyList::const_iterator DirtyList::end() const noexcept
+	{
+		return items.end();
+	}
+
+	DirtyList::DirtyList(Kind k) : kind(k), generation(++lastGeneration)
+	{
+	}
+
+	void Container::requestRedraw()
+	{
+		Component::requestRedraw();
+		forEachChild([](Component& c) {
+			c.requestRedraw();
+		});
+	}
+
+	void Container::setRetained(bool retained)
+	{
+		if (retained)
+			throw std::logic_error("containers cannot be retained");
+	}
+
+	void Container::visitChildren(const ChildVisitor& visitor)
+	{
+		for (Iterator it = firstElement(); !it.end(); it.loadNext())
+			visitor(it.current());
 	}
 
 	bool Container::handleEvent(const Event& event)
 	{
 		bool r = Component::handleEvent(event);
-		for (Iterator it = firstElement(); !it.end(); it.loadNext())
-			handleEventForComponent(event, it.current());
+		switch (event.type)
+		{
+		case Event::Type::MouseButtonDown:
+		case Event::Type::MouseButtonUp:
+		case Event::Type::MouseMoved:
+		case Event::Type::MouseLeft:
+		{
+			handleMouseEvent(event);
+			break;
+		}
+		default:
+		{
+			forEachChild([this, &event](Component& c) {
+				handleEventForComponent(event, c);
+			});
+			break;
+		}
+		}
 		return r;
 	}
 
+	void Container::updateSpatialIndex()
+	{
+		if (!spatialIndexDirty)
+			return;
+		spatialIndexDirty = false;
+
+		spatialIndex.clear();
+		mouseTracked.clear();
+		if (!spatialIndexUsed)
+		{
+			spatialIndexEnabled = false;
+			return;
+		}
+		forEachChild([this](Component& c) {
+			spatialIndex.update(c, c.getBounds());
+			if (c.isMouseOver() || c.hasMouseButtonFocus())
+				mouseTracked.push_back(&c);
+		});
+
+		spatialIndexEnabled = spatialIndex.size() >= spatialIndexThreshold;
+		if (!spatialIndexEnabled)
+		{
+			spatialIndex.clear();
+			mouseTracked.clear();
+		}
+	}
+
+	void Container::handleMouseEvent(const Event& event)
+	{
+		updateSpatialIndex();
+		if (!spatialIndexEnabled)
+		{
+			forEachChild([this, &event](Component& c) {
+				handleEventForComponent(event, c);
+			});
+			return;
+		}
+
+		//only children under cursor and children that need to be notified about leaving are visited
+		hits.clear();
+		if (event.type != Event::Type::MouseLeft)
+			spatialIndex.query(Vec2(event.mouseEvent.x, event.mouseEvent.y), hits);
+		for (Component* c : mouseTracked)
+			hits.emplace_back(spatialIndex.getKey(*c), c);
+		std::sort(hits.begin(), hits.end(), [](const SpatialIndex::Item& a, const SpatialIndex::Item& b) {
+			return a.key < b.key;
+		});
+		hits.erase(std::unique(hits.begin(), hits.end(), [](const SpatialIndex::Item& a, const SpatialIndex::Item& b) {
+			return a.key == b.key;
+		}), hits.end());
+
+		mouseTracked.clear();
+		for (const SpatialIndex::Item& i : hits)
+		{
+			handleEventForComponent(event, *i.component);
+			//children changed during handling, index is rebuilt with next event
+			if (spatialIndexDirty)
+				return;
+			if (i.component->isMouseOver() || i.component->hasMouseButtonFocus())
+				mouseTracked.push_back(i.component);
+		}
+	}
+
+	void Container::onChildResize(Component& c, const Rect& lastBounds)
+	{
+		if (!spatialIndexDirty && spatialIndexEnabled)
+			spatialIndex.update(c, c.getBounds());
+	}
+
+	void Container::useSpatialIndex() noexcept
+	{
+		spatialIndexUsed = true;
+		spatialIndexDirty = true;
+	}
+
+	void Container::invalidateSpatialIndex()
+	{
+		spatialIndexDirty = true;
+	}
+
+	void Container::queryChildren(const Rect& rect, std::vector<SpatialIndex::Item>& out)
+	{
+		updateSpatialIndex();
+		if (spatialIndexEnabled)
+		{
+			spatialIndex.query(rect, out);
+			return;
+		}
+		size_t key = 0;
+		forEachChild([&rect, &out, &key](Component& c) {
+			if (c.getBounds().intersects(rect))
+				out.emplace_back(key, &c);
+			++key;
+		});
+	}
+
+	size_t Container::getChildKey(const Component& c)
+	{
+		updateSpatialIndex();
+		if (spatialIndexEnabled)
+			return spatialIndex.getKey(c);
+		size_t key = 0, ret = 0;
+		forEachChild([&c, &key, &ret](Component& child) {
+			if (&child == &c)
+				ret = key;
+			++key;
+		});
+		return ret;
+	}
+
+	Container::Container() : spatialIndexUsed(false), spatialIndexDirty(true), spatialIndexEnabled(false)
+	{
+		//container measures lay out children
+		disableMeasureCache();
+	}
+
 	Event Container::adjustEventForComponent(const Event& event, Component& component)
 	{
 		Event copy(event);
@@ -920,6 +2015,7 @@ namespace Guider
 	{
 		Rect bounds = getBounds();
 		elements.emplace_back(child);
+		invalidateSpatialIndex();
 		child->setParent(*this);
 		child->invalidateRecursive();
 		child->invalidateVisualsRecursive();
@@ -934,7 +2030,9 @@ namespace Guider
 		{
 			if (*it == child)
 			{
+				toRedraw.erase(it->get());
 				elements.erase(it);
+				invalidateSpatialIndex();
 				return;
 			}
 		}
@@ -942,13 +2040,21 @@ namespace Guider
 	
 	void Engine::clearChildren()
 	{
+		toRedraw.clear();
 		elements.clear();
+		invalidateSpatialIndex();
 	}
 	
 	Container::Iterator Engine::firstElement()
 	{
 		return createIterator<IteratorType>(elements.begin(), elements.end());
 	}
+
+	void Engine::visitChildren(const ChildVisitor& visitor)
+	{
+		for (const auto& e : elements)
+			visitor(*e);
+	}
 	
 	void Engine::onChildNeedsRedraw(Component& c)
 	{
@@ -966,6 +2072,8 @@ namespace Guider
 	
 	void Engine::update()
 	{
+		flushEvents();
+
 		Rect bounds = getBounds();
 		for (const auto& element : elements)
 		{
@@ -990,6 +2098,40 @@ namespace Guider
 		}
 	}
 	
+	void Engine::postEvent(const Event& event)
+	{
+		++eventStats.posted;
+		if (event.type == Event::Type::MouseMoved && !events.empty() && events.back().type == Event::Type::MouseMoved)
+		{
+			//events can not be assigned, so last one is replaced
+			events.pop_back();
+			++eventStats.coalesced;
+		}
+		events.push_back(event);
+	}
+
+	void Engine::flushEvents()
+	{
+		//handlers may post new events, they are delivered with next flush
+		std::swap(events, dispatchedEvents);
+		for (const Event& event : dispatchedEvents)
+		{
+			handleEvent(event);
+			++eventStats.delivered;
+		}
+		dispatchedEvents.clear();
+	}
+
+	const Engine::EventStats& Engine::getEventStats() const noexcept
+	{
+		return eventStats;
+	}
+
+	void Engine::resetEventStats()
+	{
+		eventStats = EventStats();
+	}
+
 	void Engine::onMaskDraw(Canvas& canvas) const
 	{
 		if (!toRedraw.empty())
@@ -1005,7 +2147,7 @@ namespace Guider
 	{
 		for (const auto& element : elements)
 		{
-			if (toRedraw.count(element.get()))
+			if (toRedraw.contains(element.get()))
 			{
 				element->draw(canvas);
 			}
@@ -1019,35 +2161,37 @@ namespace Guider
 			element->redraw(canvas);
 	}
 	
-	void Engine::draw()
+	Region Engine::draw()
 	{
+		backend.resetDamage();
 		if (canvas)
 		{
 			Canvas* c = canvas.get();
 			Vec2 size = backend.getSize();
 			Rect bounds(0, 0, size.x, size.y);
+			backend.resetState();
 			backend.setBounds(bounds);
 
-			backend.setupMask();
-			backend.clearMask();
-
 			drawMask(*c);
 
-			backend.useMask();
+			backend.applyMask(backend.getDamage());
 			Component::draw(*c);
 
-			backend.disableMask();
+			backend.releaseMask();
 		}
+		return backend.getDamage();
 	}
 	
-	Engine::Engine(Backend& b) : backend(b)
+	Engine::Engine(Backend& b) : backend(b), toRedraw(DirtyList::Kind::Redraw)
 	{
+		useSpatialIndex();
 		canvas = b.getCanvas();
 		setBackend(b);
 	}
 	
-	Engine::Engine(Backend& b, const std::shared_ptr<Canvas>& c) : backend(b), canvas(c)
+	Engine::Engine(Backend& b, const std::shared_ptr<Canvas>& c) : backend(b), toRedraw(DirtyList::Kind::Redraw), canvas(c)
 	{
+		useSpatialIndex();
 		setBackend(b);
 	}
 }
\ No newline at end of file
@@ -66,6 +66,7 @@ namespace Guider
 	void CommonComponent::setPadding(const Padding& pad)
 	{
 		paddings = pad;
+		invalidate();
 	}
 
 	Padding CommonComponent::getPading() const noexcept
@@ -73,9 +74,9 @@ namespace Guider
 		return paddings;
 	}
 
-	std::pair<Component::DimensionDesc, Component::DimensionDesc> CommonComponent::measure(const DimensionDesc& width, const DimensionDesc& height)
+	std::pair<Component::DimensionDesc, Component::DimensionDesc> CommonComponent::onMeasure(const DimensionDesc& width, const DimensionDesc& height)
 	{
-		std::pair<DimensionDesc, DimensionDesc> measurements = Component::measure(width, height);
+		std::pair<DimensionDesc, DimensionDesc> measurements = Component::onMeasure(width, height);
 
 		bool w = getSizingModeHorizontal() == SizingMode::WrapContent;
 		bool h = getSizingModeVertical() == SizingMode::WrapContent;
@@ -146,7 +147,7 @@ namespace Guider
 	{
 		Rect bounds = getBounds();
 		shape->setSize(Vec2(bounds.width, bounds.height));
-		shape->draw(canvas, Rect(0, 0, bounds.width, bounds.height));
+		canvas.draw(*shape, Rect(0, 0, bounds.width, bounds.height));
 	}
 	
 	bool RectangleShapeComponent::handleEvent(const Event& event)
@@ -195,6 +196,7 @@ namespace Guider
 	void ImageComponent::setImage(const std::shared_ptr<Resources::Drawable>& i)
 	{
 		image = i;
+		invalidateVisuals();
 	}
 
 	std::shared_ptr<Resources::Drawable> ImageComponent::getImage() const noexcept
@@ -207,7 +209,7 @@ namespace Guider
 		if (image)
 		{
 			Rect bounds = getPading().calcContentArea(getBounds());
-			image->draw(canvas, bounds);
+			canvas.draw(*image, bounds);
 		}
 	}
 
@@ -229,6 +231,8 @@ namespace Guider
 
 	ImageComponent::ImageComponent(Manager& manager, const XML::Tag& tag, const StylingPack& pack) : CommonComponent(manager, tag, pack)
 	{
+		Manager::handleDefaultArguments(*this, tag, pack.style);
+
 		{
 			auto src = pack.style.getAttribute("src");
 			if (src)
@@ -317,7 +321,7 @@ namespace Guider
 		textRes->horizontalAlignment = getHorizontalTextAlignment();
 		textRes->verticalAlignment = getVerticalTextAlignment();
 
-		textRes->draw(canvas, contentRect);
+		canvas.draw(*textRes, contentRect);
 	}
 	
 	bool TextComponent::handleEvent(const Event& event)
@@ -543,6 +547,7 @@ namespace Guider
 			break;
 		}
 		}
+		invalidateVisuals();
 	}
 
 	std::shared_ptr<Resources::Drawable> BasicButtonComponent::getCurrentBackgroundDrawable() const
@@ -558,7 +563,7 @@ namespace Guider
 		if (!shape)
 			shape = getBackgroundDrawable(ButtonState::Default);
 		if (shape)
-			shape->draw(canvas, bounds.at(Vec2(0, 0)));
+			canvas.draw(*shape, bounds.at(Vec2(0, 0)));
 		TextComponent::onDraw(canvas);
 	}
 	
@@ -1,5 +1,6 @@
 #include <guider/containers.hpp>
 #include <guider/shortcuts.hpp>
+#include <guider/thread_pool.hpp>
 #include <cstdlib>
 #include <cassert>
 #include <limits>
@@ -22,9 +23,11 @@ namespace Guider
 	{
 		Rect bounds = getBounds();
 		children.emplace_back(child, x, y);
+		invalidateSpatialIndex();
 		child->setParent(*this);
 		child->poke();
-		toUpdate.insert(child.get());
+		toRedraw.insert(child.get());
+		Component::requestRedraw();
 		std::pair<DimensionDesc, DimensionDesc> measurements = child->measure(
 			DimensionDesc(bounds.width, DimensionMode::Max),
 			DimensionDesc(bounds.height, DimensionMode::Max)
@@ -43,7 +46,13 @@ namespace Guider
 			if (it->component.get() == child.get())
 			{
 				toUpdate.erase(it->component.get());
+				toRedraw.erase(it->component.get());
+				Rect last = it->component->getBounds();
 				children.erase(it);
+				invalidateSpatialIndex();
+				//uncovered children
+				redrawOverlapping(last);
+				break;
 			}
 		}
 	}
@@ -51,91 +60,78 @@ namespace Guider
 	void AbsoluteContainer::clearChildren()
 	{
 		toUpdate.clear();
+		toRedraw.clear();
 		children.clear();
+		invalidateSpatialIndex();
 	}
 	
 	Container::Iterator AbsoluteContainer::firstElement()
 	{
 		return createIterator<IteratorType>(children.begin(), children.end());
 	}
+
+	void AbsoluteContainer::visitChildren(const ChildVisitor& visitor)
+	{
+		for (const auto& e : children)
+			visitor(*e.component);
+	}
 	
 	void AbsoluteContainer::poke()
 	{
 		Component::poke();
+		if (toUpdate.empty())
+			return;
+
+		//only stained children are measured, positions of others can not change
+		Rect area = getBounds();
+		DimensionDesc ww(area.width, DimensionMode::Max);
+		DimensionDesc hh(area.height, DimensionMode::Max);
 		for (auto& i : children)
 		{
-			//TODO: move to another method
-			i.component->poke();
-			Rect bounds = getBounds();
-			std::pair<DimensionDesc, DimensionDesc> measurements = i.component->measure(DimensionDesc(bounds.width, DimensionMode::Max),
-				DimensionDesc(bounds.height, DimensionMode::Max)
-			);
+			Component* c = i.component.get();
+			if (!toUpdate.contains(c))
+				continue;
 
-			bounds.left = i.x;
-			bounds.top = i.y;
-			bounds.width = measurements.first.value;
-			bounds.height = measurements.second.value;
-			setBounds(*i.component.get(), bounds);
-			toUpdate.insert(i.component.get());
-
-			for (auto& j : children)
+			std::pair<DimensionDesc, DimensionDesc> measurements = c->measure(ww, hh);
+			Rect last = c->getBounds();
+			Rect bounds(i.x, i.y, measurements.first.value, measurements.second.value);
+			if (bounds != last)
 			{
-				if (i.component != j.component && bounds.intersects(j.component->getBounds()))
-				{
-					toUpdate.insert(j.component.get());
-				}
+				setBounds(*c, bounds);
+				//children under previous area have to cover it again
+				redrawOverlapping(last);
 			}
+			if (!c->isClean())
+				c->poke();
 		}
+		toUpdate.clear();
 	}
 	
 	void AbsoluteContainer::onResize(const Rect& last)
 	{
-		if (last != getBounds())
+		//children are measured against size only, moving the container does not change them
+		Rect bounds = getBounds();
+		if (bounds.width != last.width || bounds.height != last.height)
 		{
 			for (auto& i : children)
 				toUpdate.insert(i.component.get());
+			invalidate();
 		}
 	}
 	
 	void AbsoluteContainer::onChildStain(Component& c)
 	{
-		for (auto& i : children)
-		{
-			if (i.component.get() == &c)
-			{
-				Rect bounds = getBounds();
-				std::pair<DimensionDesc, DimensionDesc> measurements = c.measure(DimensionDesc(bounds.width, DimensionMode::Max),
-					DimensionDesc(bounds.height, DimensionMode::Max)
-				);
-
-				bounds.left = i.x;
-				bounds.top = i.y;
-				bounds.width = measurements.first.value;
-				bounds.height = measurements.second.value;
-				setBounds(c, bounds);
-				toUpdate.insert(&c);
-
-				for (auto& j : children)
-				{
-					if (i.component != j.component && bounds.intersects(j.component->getBounds()))
-					{
-						toUpdate.insert(j.component.get());
-					}
-				}
-
-				break;
-			}
-		}
+		toUpdate.insert(&c);
 	}
 	
 	void AbsoluteContainer::onChildNeedsRedraw(Component& c)
 	{
-		toUpdate.insert(&c);
+		toRedraw.insert(&c);
 	}
 
 	void AbsoluteContainer::onMaskDraw(Canvas& canvas) const
 	{
-		for (auto i : toUpdate)
+		for (auto i : toRedraw)
 		{
 			i->drawMask(canvas);
 		}
@@ -143,31 +139,52 @@ namespace Guider
 	
 	void AbsoluteContainer::onDraw(Canvas& canvas)
 	{
-		if (toUpdate.size() > 0)
+		if (!toRedraw.empty())
 		{
-			Rect bounds = getGlobalBounds();
-			std::vector<Rect> base;
-			base.reserve(toUpdate.size());
-			for (auto i : toUpdate)
+			//children overlapping redrawn ones are drawn again in order of children,
+			//only children near redrawn ones are visited
+			overlapping.clear();
+			for (auto i : toRedraw)
 			{
-				base.emplace_back(i->getBounds());
-			}
-			for (const auto& i : children)
-			{
-				Rect localBounds = i.component->getBounds();
-				for (const auto& rect : base)
-				{
-					if (localBounds.intersects(rect))
-					{
-						i.component->draw(canvas);
-						break;
-					}
-				}
+				overlapping.emplace_back(getChildKey(*i), i);
+				queryChildren(i->getBounds(), overlapping);
 			}
+			std::sort(overlapping.begin(), overlapping.end(), [](const SpatialIndex::Item& a, const SpatialIndex::Item& b) {
+				return a.key < b.key;
+			});
+			overlapping.erase(std::unique(overlapping.begin(), overlapping.end(), [](const SpatialIndex::Item& a, const SpatialIndex::Item& b) {
+				return a.key == b.key;
+			}), overlapping.end());
+			for (const auto& i : overlapping)
+				i.component->draw(canvas);
 		}
+		toRedraw.clear();
+	}
+
+	void AbsoluteContainer::onRedraw(Canvas& canvas)
+	{
+		for (const auto& i : children)
+			i.component->redraw(canvas);
+		toRedraw.clear();
+	}
+
+	void AbsoluteContainer::redrawOverlapping(const Rect& rect)
+	{
+		//only children near rect are visited
+		overlapping.clear();
+		queryChildren(rect, overlapping);
+		for (const auto& i : overlapping)
+			toRedraw.insert(i.component);
+		if (!overlapping.empty())
+			Component::requestRedraw();
 	}
 	
 
+	AbsoluteContainer::AbsoluteContainer() : toUpdate(DirtyList::Kind::Update), toRedraw(DirtyList::Kind::Redraw)
+	{
+		useSpatialIndex();
+	}
+
 	AbsoluteContainer::Element::Element(const Component::Type& component, float x, float y) : component(component), x(x), y(y)
 	{
 		//empty
@@ -201,6 +218,7 @@ namespace Guider
 			backgroundColor.a = 255;
 		invalidateVisuals();
 		firstDraw = true;
+		contentValid = false;
 	}
 	
 	Color ListContainer::getBackgroundColor() const noexcept
@@ -219,62 +237,116 @@ namespace Guider
 		return newOffset;
 	}
 
+	void ListContainer::setSizeEstimation(bool enabled, float size)
+	{
+		estimation = enabled;
+		estimatedSize = size;
+		//without estimation every child has to be measured
+		if (!estimation)
+		{
+			for (const auto& e : children)
+			{
+				if (!e.measured)
+					toUpdate.insert(e.component.get());
+			}
+		}
+		invalidate();
+	}
+
+	bool ListContainer::isSizeEstimationEnabled() const noexcept
+	{
+		return estimation;
+	}
+
+	void ListContainer::setScrollByCopy(bool enabled)
+	{
+		scrollByCopy = enabled;
+		content.reset();
+		contentBack.reset();
+		contentValid = false;
+		invalidateVisuals();
+	}
+
+	bool ListContainer::isScrollByCopyEnabled() const noexcept
+	{
+		return scrollByCopy;
+	}
+
 	void ListContainer::addChild(const Component::Type& child)
 	{
 		child->setParent(*this);
 		child->invalidateRecursive();
 
-		children.emplace_back(child, size, 0.f);
-
 		Component* p = child.get();
-		childMapping[p] = --children.end();
+		childMapping[p] = children.size();
+		children.emplace_back(child, 0.f);
+		sizes.pushBack(0.f);
+		unmeasured.pushBack(1.f);
+		invalidateSpatialIndex();
 
 		toRedraw.insert(p);
 		toUpdate.insert(p);
 
 		invalidate();
 	}
-	//TODO: do some smart trick to avoid recalculating everything when erasing elements
+
 	void ListContainer::removeChild(const Component::Type& child)
 	{
-		auto it = std::find_if(children.begin(), children.end(), [&child](const Element& e) {
-			return child.get() == e.component.get();
-		});
-
-		recalculateVisibleElements();
-		
-		Component* p = it->component.get();
-
-		visible.erase(p);
-		beforeVisible.erase(p);
-		updated.erase(p);
-
-		childMapping.erase(p);
-
-		children.erase(it);
-		invalidate();
+		auto it = childMapping.find(child.get());
+		if (it != childMapping.end())
+			removeChild(static_cast<unsigned>(it->second));
 	}
 	
 	void ListContainer::removeChild(unsigned n)
 	{
-		removeChild(std::next(children.begin(), n)->component);
+		Element& child = children.at(n);
+		Component* p = child.component.get();
+		toUpdate.erase(p);
+		toRedraw.erase(p);
+		childMapping.erase(p);
+		if (child.measured)
+		{
+			measuredSum -= child.size;
+			--measuredCount;
+		}
+
+		children.erase(children.begin() + n);
+		sizes.erase(n);
+		unmeasured.erase(n);
+		for (size_t i = n; i < children.size(); ++i)
+			childMapping[children[i].component.get()] = i;
+		//drawn content still contains removed child
+		if (n >= laidOutBegin && n < laidOutEnd)
+			contentValid = false;
+		//laid out range has to follow indices of children after removed one
+		if (n < laidOutBegin)
+			--laidOutBegin;
+		if (n < laidOutEnd)
+			--laidOutEnd;
+
+		recalculateVisibleElements();
+		invalidateSpatialIndex();
+		invalidate();
 	}
 	
 	void ListContainer::clearChildren()
 	{
 		children.clear();
+		sizes.clear();
+		unmeasured.clear();
+		measuredSum = 0;
+		measuredCount = 0;
 		toUpdate.clear();
 		toRedraw.clear();
-		toOffset.clear();
-
-		updated.clear();
-		visible.clear();
-		beforeVisible.clear();
 
 		childMapping.clear();
 
-		visibleBegin = children.end();
-		visibleEnd = children.end();
+		visibleBegin = 0;
+		visibleEnd = 0;
+		laidOutBegin = 0;
+		laidOutEnd = 0;
+
+		invalidateSpatialIndex();
 	}
 	
 	size_t ListContainer::getChildrenCount() const
@@ -284,21 +356,23 @@ namespace Guider
 	
 	Component::Type ListContainer::getChild(unsigned i)
 	{
-		return std::next(children.begin(), i)->component;
+		return children.at(i).component;
 	}
 	
 	void ListContainer::onMaskDraw(Canvas& canvas) const
 	{
-		if (backgroundColor.a > 0 && firstDraw)
+		//shifting content changes the whole list
+		bool shifted = scrollByCopy && (!contentValid || contentOffset != offset);
+		if ((backgroundColor.a > 0 && firstDraw) || shifted)
 		{
 			Component::onMaskDraw(canvas);
 		}
 		else
 		{
-			for (auto it = visibleBegin; it != visibleEnd; ++it)
+			for (size_t i = visibleBegin; i < visibleEnd; ++i)
 			{
-				Component* p = it->component.get();
-				if (toRedraw.count(p))
+				Component* p = children[i].component.get();
+				if (toRedraw.contains(p))
 					p->drawMask(canvas);
 			}
 
@@ -321,7 +395,7 @@ namespace Guider
 			}
 			if (offset + size < d)
 			{
-				getBackend()->addToMask(bounds);
+				getBackend()->addDamagedRect(bounds);
 			}
 			if (offset > 0)
 			{
@@ -334,19 +408,25 @@ namespace Guider
 				{
 					bounds.height = offset;
 				}
-				getBackend()->addToMask(bounds);
+				getBackend()->addDamagedRect(bounds);
 			}
 		}
 	}
 	
 	void ListContainer::onDraw(Canvas& canvas)
 	{
+		if (scrollByCopy)
+		{
+			drawContent(canvas);
+			toRedraw.clear();
+			return;
+		}
 		if (backgroundColor.a > 0 && firstDraw)
 			canvas.drawRectangle(getBounds().at(Vec2(0.f, 0.0f)), backgroundColor);
-		for (auto it = visibleBegin; it != visibleEnd; ++it)
+		for (size_t i = visibleBegin; i < visibleEnd; ++i)
 		{
-			Component* p = it->component.get();
-			if (backgroundColor.a > 0 || toRedraw.count(p))
+			Component* p = children[i].component.get();
+			if (backgroundColor.a > 0 || toRedraw.contains(p))
 			{
 				p->draw(canvas);
 			}
@@ -356,14 +436,31 @@ namespace Guider
 	
 	void ListContainer::onRedraw(Canvas& canvas)
 	{
-		if (backgroundColor.a > 0)
-			canvas.drawRectangle(getBounds().at(Vec2(0.f, 0.0f)), backgroundColor);
-		for (auto it = visibleBegin; it != visibleEnd; ++it)
-			it->component->redraw(canvas);
+		if (scrollByCopy)
+		{
+			drawContent(canvas);
+		}
+		else
+		{
+			if (backgroundColor.a > 0)
+				canvas.drawRectangle(getBounds().at(Vec2(0.f, 0.0f)), backgroundColor);
+			for (size_t i = visibleBegin; i < visibleEnd; ++i)
+				children[i].component->redraw(canvas);
+		}
 		toRedraw.clear();
 		firstDraw = false;
 	}
 
+	void ListContainer::requestRedraw()
+	{
+		Component::requestRedraw();
+		//copied content already has children drawn, changed ones request their redraw themselves
+		if (scrollByCopy && contentValid)
+			return;
+		for (size_t i = visibleBegin; i < visibleEnd; ++i)
+			children[i].component->requestRedraw();
+	}
+
 	void ListContainer::poke()
 	{
 		Rect bounds = getBounds().at({0.f, 0.f});
@@ -382,60 +479,124 @@ namespace Guider
 			hh.value = 0;
 			hh.mode = DimensionMode::Min;
 		}
+		float lastSize = size;
 		std::vector<Component*> toPoke;
 		toPoke.reserve(toUpdate.size());
-		for (auto i : toUpdate)
+		if (estimation)
 		{
-			toPoke.emplace_back(i);
-			//measure and update size
-			auto it = childMapping.at(i);
-
-			auto measurements = i->measure(ww, hh);
-			if (getOrientation() == Orientation::Horizontal)
-				it->newSize = std::min(measurements.first.value, bounds.width);
-			else
-				it->newSize = std::min(measurements.second.value, bounds.height);
-			if (it->newSize != it->size)
-				updated.insert(i);
+			//stained children are estimated again, only the ones near viewport are measured
+			for (auto i : toUpdate)
+				resetChildSize(childMapping.at(i));
+			toUpdate.clear();
+			measureNearChildren(toPoke);
 		}
-		toUpdate.clear();
-		
-		adjustVisibleElements();
-		offset = newOffset;
-		for (auto i : updated)
+		else
 		{
-			Element& child = *childMapping.at(i);
-			child.size = child.newSize;
+			for (auto i : toUpdate)
+			{
+				toPoke.emplace_back(i);
+				//measure and update size
+				auto measurements = i->measure(ww, hh);
+				if (getOrientation() == Orientation::Horizontal)
+					setChildSize(childMapping.at(i), std::min(measurements.first.value, bounds.width));
+				else
+					setChildSize(childMapping.at(i), std::min(measurements.second.value, bounds.height));
+			}
+			toUpdate.clear();
 		}
+		
+		float scrolled = newOffset - offset;
+		offset = newOffset;
+		recalculateVisibleElements();
 
-		if (updated.size() > 0)
+		if (!children.empty())
 		{
-			updated.clear();
-			for (auto it = visibleBegin; it != visibleEnd; ++it)
+			//only visible children are laid out, unchanged ones are skipped
+			bool changed = false;
+			float off = getChildOffset(visibleBegin);
+			for (size_t i = visibleBegin; i < visibleEnd; ++i)
 			{
-				Element& child = *it;
+				Element& child = children[i];
 				if (getOrientation() == Orientation::Horizontal)
 				{
-					bounds.left = child.offset + newOffset;
-					bounds.width = child.newSize;
+					bounds.left = off + newOffset;
+					bounds.width = child.size;
 				}
 				else
 				{
-					bounds.top = child.offset + newOffset;
-					bounds.height = child.newSize;
+					bounds.top = off + newOffset;
+					bounds.height = child.size;
 				}
-
-				setBounds(*child.component, bounds);
+				off += child.size;
+
+				Rect last = child.component->getBounds();
+				bool moved = last != bounds;
+				bool wasVisible = i >= laidOutBegin && i < laidOutEnd;
+				//children moved only by scrolling are already drawn in shifted content
+				if (scrollByCopy && moved && wasVisible && last.width == bounds.width && last.height == bounds.height &&
+					(orientation == Orientation::Horizontal ? bounds.left - last.left == scrolled && bounds.top == last.top : bounds.top - last.top == scrolled && bounds.left == last.left))
+				{
+					moveBounds(*child.component, bounds);
+					changed = true;
+				}
+				//children outside of viewport are not drawn, so their own redraw request may be still pending
+				else if (moved || !wasVisible)
+				{
+					if (moved)
+						setBounds(*child.component, bounds);
+					toRedraw.insert(child.component.get());
+					changed = true;
+				}
+			}
+			//rows left viewport without scrolling, nothing would be drawn over their pixels
+			if (scrollByCopy && scrolled == 0 && (size != lastSize || visibleBegin != laidOutBegin || visibleEnd != laidOutEnd))
+			{
+				contentValid = false;
+				changed = true;
 			}
+			if (changed)
+				Component::requestRedraw();
 			for (auto i : toPoke)
 				i->poke();
 		}
+		laidOutBegin = visibleBegin;
+		laidOutEnd = visibleEnd;
+
+		//measurements corrected estimated size, parent has to measure list again
+		bool wraps = orientation == Orientation::Horizontal ? getSizingModeHorizontal() == SizingMode::WrapContent : getSizingModeVertical() == SizingMode::WrapContent;
+		if (estimation && wraps && size != lastSize)
+			invalidate();
 	}
 
 	void ListContainer::onResize(const Rect& lastBounds)
 	{
-		//TODO: smart invalidation
-		invalidateRecursive();
+		//children are measured against size only, moving the list does not change them
+		Rect bounds = getBounds();
+		bool resized = bounds.width != lastBounds.width || bounds.height != lastBounds.height;
+		if (!estimation)
+		{
+			if (resized)
+				invalidateRecursive();
+			return;
+		}
+
+		//sizes depend on size across the list, children are measured again when they come near viewport
+		if (orientation == Orientation::Horizontal ? bounds.height != lastBounds.height : bounds.width != lastBounds.width)
+		{
+			for (auto& e : children)
+			{
+				e.measured = false;
+				e.size = 0;
+			}
+			sizes.assign(std::vector<float>(children.size(), 0.f));
+			unmeasured.assign(std::vector<float>(children.size(), 1.f));
+			measuredSum = 0;
+			measuredCount = 0;
+			for (size_t i = visibleBegin; i < visibleEnd; ++i)
+				children[i].component->invalidateRecursive();
+		}
+		if (resized)
+			invalidate();
 	}
 
 	void ListContainer::onChildStain(Component& c)
@@ -448,17 +609,32 @@ namespace Guider
 		toRedraw.insert(&c);
 	}
 
+	bool ListContainer::handleEvent(const Event& event)
+	{
+		bool r = Container::handleEvent(event);
+		//images belong to previous backend
+		if (event.type == Event::Type::BackendConnected)
+		{
+			content.reset();
+			contentBack.reset();
+			contentValid = false;
+		}
+		return r;
+	}
+
 	ListContainer::Iterator ListContainer::firstElement()
 	{
 		return createIterator<IteratorType>(children.begin(), children.end());
 	}
 
-	std::pair<DimensionDesc, DimensionDesc> ListContainer::measure(const DimensionDesc& w, const DimensionDesc& h)
+	void ListContainer::visitChildren(const ChildVisitor& visitor)
 	{
-		//TODO: move to function i guess
-		float off = 0;
-		bool offsetting = false;
+		for (const auto& e : children)
+			visitor(*e.component);
+	}
 
+	std::pair<DimensionDesc, DimensionDesc> ListContainer::onMeasure(const DimensionDesc& w, const DimensionDesc& h)
+	{
 		Rect bounds = getBounds();
 		DimensionDesc ww(bounds.width, DimensionMode::Max);
 		DimensionDesc hh(bounds.height, DimensionMode::Max);
@@ -474,22 +650,25 @@ namespace Guider
 			hh.mode = DimensionMode::Min;
 		}
 
-		for (auto& child : children)
+		//sizes of clean children are already known, resizing the list invalidates all of them
+		for (auto c : toUpdate)
 		{
-			auto measurements = child.component->measure(ww,hh);
-			if (orientation == Orientation::Horizontal)
+			//estimated children are measured during layout, only when they are near viewport
+			if (estimation)
 			{
-				child.newSize = measurements.first.value;
+				resetChildSize(childMapping.at(c));
+				continue;
 			}
+			auto measurements = c->measure(ww, hh);
+			if (orientation == Orientation::Horizontal)
+				setChildSize(childMapping.at(c), measurements.first.value);
 			else
-			{
-				child.newSize = measurements.second.value;
-			}
+				setChildSize(childMapping.at(c), measurements.second.value);
 		}
 
-		recalculateVisibleElements();
+		size = getTotalSize();
 
-		std::pair<DimensionDesc, DimensionDesc> measurements = Component::measure(w, h);
+		std::pair<DimensionDesc, DimensionDesc> measurements = Component::onMeasure(w, h);
 		if (getSizingModeHorizontal() == SizingMode::WrapContent && orientation == Orientation::Horizontal)
 		{
 			measurements.first = DimensionDesc(size, DimensionMode::Exact);
@@ -501,10 +680,12 @@ namespace Guider
 		return measurements;
 	}
 
-	ListContainer::ListContainer() : orientation(Orientation::Vertical), size(0), offset(0), newOffset(0), backgroundColor(0, 0, 0, 0), firstDraw(true)
+	ListContainer::ListContainer() : orientation(Orientation::Vertical), size(0), offset(0), newOffset(0),
+		measuredSum(0), measuredCount(0), estimation(false), estimatedSize(-1.f),
+		toUpdate(DirtyList::Kind::Update), toRedraw(DirtyList::Kind::Redraw), visibleBegin(0), visibleEnd(0), laidOutBegin(0), laidOutEnd(0), backgroundColor(0, 0, 0, 0), firstDraw(true),
+		scrollByCopy(false), contentValid(false), contentOffset(0)
 	{
-		visibleBegin = children.end();
-		visibleEnd = children.end();
+		useSpatialIndex();
 	}
 
 	ListContainer::ListContainer(Manager& manager, const XML::Tag& tag, const StylingPack& pack) : ListContainer()
@@ -534,114 +715,197 @@ namespace Guider
 		}
 	}
 
-	void ListContainer::adjustVisibleElements()
+	void ListContainer::drawContent(Canvas& canvas)
 	{
-		Rect bounds = getBounds();
-		float s = getOrientation() == Orientation::Horizontal ? bounds.width : bounds.height;
+		Vec2 s(getBounds().width, getBounds().height);
+		if (s.x <= 0 || s.y <= 0)
+			return;
+		Rect area(0.f, 0.f, s.x, s.y);
 
-		if (newOffset > s || visibleBegin == children.end() || true)
+		if (!content || contentSize.x != s.x || contentSize.y != s.y)
 		{
-			recalculateVisibleElements();
-			return;
+			content = getBackend()->createImage(s);
+			contentBack = getBackend()->createImage(s);
+			contentSize = s;
+			contentValid = false;
 		}
 
-		float diff = 0;
-		float fullDiff = 0;
-		for (auto i : updated)
+		if (!contentValid)
 		{
-			Element& child = *childMapping.at(i);
-			fullDiff += child.newSize - child.size;
-			if (beforeVisible.count(i))
-			{
-				diff += child.newSize - child.size;
-			}
+			content->clear();
+			getBackend()->pushLayer(*content, s);
+			if (backgroundColor.a > 0)
+				content->drawRectangle(area, backgroundColor);
+			for (size_t i = visibleBegin; i < visibleEnd; ++i)
+				children[i].component->redraw(*content);
+			getBackend()->popLayer();
+			contentValid = true;
 		}
-
-		float trueDiff = newOffset - offset + diff;
-
-		if (trueDiff < 0)
+		else if (contentOffset != offset || !toRedraw.empty())
 		{
-			//elements moved back, so iterate forward adjusting visible bounds
-			float off = 0;
-			for (auto it = visibleBegin; it != children.end(); ++it)
+			//content is copied shifted, children it does not contain are drawn again
+			float delta = offset - contentOffset;
+			Rect shifted = area;
+			Rect valid = area;
+			if (orientation == Orientation::Horizontal)
+			{
+				shifted.left += delta;
+				valid.left = std::max(0.f, delta);
+				valid.width = std::min(s.x, s.x + delta) - valid.left;
+			}
+			else
+			{
+				shifted.top += delta;
+				valid.top = std::max(0.f, delta);
+				valid.height = std::min(s.y, s.y + delta) - valid.top;
+			}
+			//only part of child inside viewport has to be in shifted content
+			auto copied = [&](size_t i) {
+				Component* p = children[i].component.get();
+				Rect b = p->getBounds();
+				return !toRedraw.contains(p) && std::max(b.left, 0.f) >= valid.left && std::max(b.top, 0.f) >= valid.top &&
+					std::min(b.left + b.width, s.x) <= valid.left + valid.width && std::min(b.top + b.height, s.y) <= valid.top + valid.height;
+			};
+
+			contentBack->clear();
+			getBackend()->pushLayer(*contentBack, s);
+			if (backgroundColor.a > 0)
+				contentBack->drawRectangle(area, backgroundColor);
+			for (size_t i = visibleBegin; i < visibleEnd;)
 			{
-				if (it == visibleBegin && it->offset + it->newSize + diff + newOffset < 0)
+				if (!copied(i))
 				{
-					visible.erase(it->component.get());
-					beforeVisible.insert(it->component.get());
-					if (visibleEnd == visibleBegin)
-						++visibleEnd;
-					++visibleBegin;
+					children[i].component->redraw(*contentBack);
+					++i;
+					continue;
 				}
-				else
+				//consecutive copied children are copied at once
+				Rect run = children[i].component->getBounds();
+				for (++i; i < visibleEnd && copied(i); ++i)
 				{
-					if (it == visibleBegin)
-					{
-						it->offset += diff;
-						off = it->offset;
-						updated.insert(it->component.get());
-						if (visibleEnd == visibleBegin)
-							++visibleEnd;
-					}
+					Rect b = children[i].component->getBounds();
+					if (orientation == Orientation::Horizontal)
+						run.width = b.left + b.width - run.left;
 					else
-					{
-						it->offset = off;
-						updated.insert(it->component.get());
-					}
-					off += it->newSize;
-					//reached last visible element
-					if (off + newOffset > s)
-					{
-						visibleEnd = ++it;
-						break;
-					}
-					if (it == visibleEnd)
-					{
-						//more visible elements found
-						if (off + newOffset < s)
-						{
-							visible.insert(it->component.get());
-							++visibleEnd;
-						}
-						//end of visible elements
-						break;
-					}
+						run.height = b.top + b.height - run.top;
 				}
+				getBackend()->pushDrawOffset(run.position());
+				getBackend()->pushBounds(run.at(Vec2(0.f, 0.f)));
+				contentBack->draw(content->getImage(), Rect(shifted.left - run.left, shifted.top - run.top, s.x, s.y));
+				getBackend()->popBounds();
+				getBackend()->popDrawOffset();
 			}
+			getBackend()->popLayer();
+			std::swap(content, contentBack);
+		}
+		contentOffset = offset;
+
+		canvas.draw(content->getImage(), area);
+	}
+
+	void ListContainer::setChildSize(size_t index, float size)
+	{
+		Element& child = children[index];
+		measuredSum += size - child.size;
+		if (!child.measured)
+		{
+			child.measured = true;
+			unmeasured.set(index, 0.f);
+			++measuredCount;
+		}
+		if (child.size != size)
+		{
+			child.size = size;
+			sizes.set(index, size);
+		}
+	}
+
+	void ListContainer::resetChildSize(size_t index)
+	{
+		Element& child = children[index];
+		if (!child.measured)
+			return;
+		child.measured = false;
+		unmeasured.set(index, 1.f);
+		--measuredCount;
+		measuredSum -= child.size;
+		child.size = 0;
+		sizes.set(index, 0.f);
+	}
+
+	float ListContainer::getEstimatedSize() const
+	{
+		if (estimatedSize >= 0)
+			return estimatedSize;
+		return measuredCount > 0 ? static_cast<float>(measuredSum / measuredCount) : 0.f;
+	}
+
+	float ListContainer::getChildOffset(size_t index) const
+	{
+		return sizes.prefix(index) + unmeasured.prefix(index) * getEstimatedSize();
+	}
+
+	float ListContainer::getTotalSize() const
+	{
+		return sizes.total() + unmeasured.total() * getEstimatedSize();
+	}
+
+	size_t ListContainer::getChildAt(float offset) const
+	{
+		return std::min(sizes.upperBound(offset, unmeasured, getEstimatedSize()), children.size());
+	}
+
+	void ListContainer::measureNearChildren(std::vector<Component*>& measured)
+	{
+		Rect bounds = getBounds();
+		DimensionDesc ww(bounds.width, DimensionMode::Max);
+		DimensionDesc hh(bounds.height, DimensionMode::Max);
+		float s = bounds.height;
+
+		if (orientation == Orientation::Horizontal)
+		{
+			ww.value = 0;
+			ww.mode = DimensionMode::Min;
+			s = bounds.width;
+		}
+		else
+		{
+			hh.value = 0;
+			hh.mode = DimensionMode::Min;
 		}
-		else if (trueDiff > 0)
+
+		size_t count = children.size();
+		//sizes are not clipped to viewport, wrapping list would never grow past its estimate
+		auto measureChild = [&](size_t i) {
+			Element& child = children[i];
+			auto measurements = child.component->measure(ww, hh);
+			setChildSize(i, orientation == Orientation::Horizontal ? measurements.first.value : measurements.second.value);
+			measured.emplace_back(child.component.get());
+		};
+
+		bool changed = true;
+		while (changed)
 		{
-			//elements moved forward, iterate backwards to find new visibleBegin
-			auto it = visibleBegin;
-			float off = it->offset + diff;
-			visible.clear();
-			if (off + newOffset > 0 && visibleBegin != children.begin())
+			changed = false;
+			size_t begin = getChildAt(-newOffset - s);
+			size_t end = std::min(getChildAt(2 * s - newOffset) + 1, count);
+			//without any measured child estimate is unknown, so single child is measured to get it
+			if (estimatedSize < 0 && measuredCount == 0)
 			{
-				auto prev = it;
-				--it;
-				for (it;; --it)
+				if (count > 0)
 				{
-					beforeVisible.erase(it->component.get());
-					off -= it->newSize;
-					if (off + newOffset < 0)
-						break;
-
-					if (it == children.begin())
-						break;
+					measureChild(std::min(begin, count - 1));
+					changed = true;
+				}
+				continue;
+			}
+			for (size_t i = begin; i < end; ++i)
+			{
+				if (!children[i].measured)
+				{
+					measureChild(i);
+					changed = true;
 				}
-				visibleBegin = it;
-			}
-			visibleEnd = visibleBegin;
-			//not that we have new visibleBegin, iterate forward from there adjusting offsets and find new visibleEnd
-			for (it; it != children.end(); ++it)
-			{
-				if (it == visibleEnd)
-					++visibleEnd;
-				it->offset = off;
-				updated.insert(it->component.get());
-				off += it->newSize;
-				if (off + newOffset > s)
-					break;
 			}
 		}
 	}
@@ -651,64 +915,672 @@ namespace Guider
 		Rect bounds = getBounds();
 
 		float s = getOrientation() == Orientation::Horizontal ? bounds.width : bounds.height;
+		size_t count = children.size();
 
-		enum class State
-		{
-			BeforeVisible,
-			Visible,
-			AfterVisible
-		};
+		//first child ending after start of the view, first child starting after its end
+		float last = s - newOffset;
+		visibleBegin = getChildAt(-newOffset);
+		visibleEnd = last < 0 ? 0 : std::min(getChildAt(last) + 1, count);
+		if (visibleBegin > visibleEnd)
+			visibleBegin = visibleEnd;
 
-		float off = 0;
+		size = getTotalSize();
+	}
 
-		State state = State::BeforeVisible;
-		visible.clear();
-		beforeVisible.clear();
-		visibleBegin = children.end();
-		visibleEnd = children.end();
+	ListContainer::Element::Element(const std::shared_ptr<Component>& component, float size) : component(component), size(size), measured(false)
+	{
+	}
 
-		//simply calculate offsets from scratch
-		for (auto it = children.begin(); it != children.end(); ++it)
-		{
-			Element& element = *it;
-			if (state != State::AfterVisible && off + newOffset > s)
-			{
-				state = State::AfterVisible;
-				visibleEnd = it;
-			}
 
-			element.offset = off;
-			updated.insert(element.component.get());
-			off += element.newSize;
+	void PrefixSumTree::pushBack(float value)
+	{
+		if (tree.empty())
+			tree.push_back(0.0);
+		values.push_back(value);
 
-			if (state == State::BeforeVisible && off + newOffset > 0)
-			{
-				state = State::Visible;
-				visibleBegin = it;
-			}
+		//node i covers (i - lowbit(i), i], sum it from nodes already stored
+		size_t i = values.size();
+		size_t low = i & (~i + 1);
+		double sum = value;
+		for (size_t j = 1; j < low; j <<= 1)
+			sum += tree[i - j];
+		tree.push_back(sum);
+	}
 
-			switch (state)
-			{
-			case State::BeforeVisible:
-			{
-				beforeVisible.insert(element.component.get());
-				break;
-			}
-			case State::Visible:
-			{
-				visible.insert(element.component.get());
-				break;
-			}
-			default:
-				break;
+	void PrefixSumTree::erase(size_t index)
+	{
+		values.erase(values.begin() + index);
+		rebuild();
+	}
+
+	void PrefixSumTree::clear()
+	{
+		values.clear();
+		tree.clear();
+	}
+
+	void PrefixSumTree::assign(const std::vector<float>& v)
+	{
+		values.assign(v.begin(), v.end());
+		rebuild();
+	}
+
+	void PrefixSumTree::set(size_t index, float value)
+	{
+		double delta = static_cast<double>(value) - values[index];
+		values[index] = value;
+		for (size_t i = index + 1; i < tree.size(); i += i & (~i + 1))
+			tree[i] += delta;
+	}
+
+	float PrefixSumTree::get(size_t index) const
+	{
+		return static_cast<float>(values[index]);
+	}
+
+	float PrefixSumTree::prefix(size_t count) const
+	{
+		double sum = 0;
+		for (size_t i = std::min(count, values.size()); i > 0; i -= i & (~i + 1))
+			sum += tree[i];
+		return static_cast<float>(sum);
+	}
+
+	float PrefixSumTree::total() const
+	{
+		return prefix(values.size());
+	}
+
+	size_t PrefixSumTree::upperBound(float value) const
+	{
+		size_t n = values.size();
+		size_t step = 1;
+		while (step * 2 <= n)
+			step *= 2;
+
+		size_t pos = 0;
+		double rest = value;
+		for (; n > 0 && step > 0; step >>= 1)
+		{
+			if (pos + step <= n && tree[pos + step] <= rest)
+			{
+				pos += step;
+				rest -= tree[pos];
+			}
+		}
+		return pos;
+	}
+
+	size_t PrefixSumTree::upperBound(float value, const PrefixSumTree& counts, float weight) const
+	{
+		assert(counts.size() == values.size());
+		size_t n = values.size();
+		size_t step = 1;
+		while (step * 2 <= n)
+			step *= 2;
+
+		size_t pos = 0;
+		double rest = value;
+		for (; n > 0 && step > 0; step >>= 1)
+		{
+			if (pos + step <= n)
+			{
+				double sum = tree[pos + step] + weight * counts.tree[pos + step];
+				if (sum <= rest)
+				{
+					pos += step;
+					rest -= sum;
+				}
+			}
+		}
+		return pos;
+	}
+
+	size_t PrefixSumTree::size() const noexcept
+	{
+		return values.size();
+	}
+
+	void PrefixSumTree::rebuild()
+	{
+		size_t n = values.size();
+		tree.assign(n + 1, 0.0);
+		for (size_t i = 1; i <= n; ++i)
+		{
+			tree[i] += values[i - 1];
+			size_t parent = i + (i & (~i + 1));
+			if (parent <= n)
+				tree[parent] += tree[i];
+		}
+	}
+
+	
+	float ListAdapter::estimateSize(size_t) const
+	{
+		return -1.f;
+	}
+
+
+	void RecyclerListContainer::registerProperties(Manager& manager, const std::string& name)
+	{
+		manager.registerPropertyForComponent<Orientation>(name, "orientation", [](const std::string& s) {
+			return s == "horizontal" ? Orientation::Horizontal : Orientation::Vertical;
+		});
+		manager.registerColorProperty(name, "backgroundColor");
+	}
+
+	void RecyclerListContainer::setAdapter(const std::shared_ptr<ListAdapter>& adapter)
+	{
+		this->adapter = adapter;
+		//views of previous adapter cannot display new items
+		clearChildren();
+	}
+
+	std::shared_ptr<ListAdapter> RecyclerListContainer::getAdapter() const
+	{
+		return adapter;
+	}
+
+	void RecyclerListContainer::notifyDataSetChanged()
+	{
+		itemsChanged = true;
+		invalidate();
+	}
+
+	void RecyclerListContainer::notifyItemChanged(size_t index)
+	{
+		if (index < firstItem || index >= firstItem + views.size())
+			return;
+		Component& view = *views[index - firstItem];
+		adapter->bindView(view, index);
+		toUpdate.insert(&view);
+		invalidate();
+	}
+
+	void RecyclerListContainer::setOrientation(Orientation orientation)
+	{
+		this->orientation = orientation;
+		itemsChanged = true;
+		invalidate();
+	}
+
+	Orientation RecyclerListContainer::getOrientation() const noexcept
+	{
+		return orientation;
+	}
+
+	void RecyclerListContainer::setBackgroundColor(const Color& color)
+	{
+		backgroundColor = color;
+		if (backgroundColor.a > 0)
+			backgroundColor.a = 255;
+		invalidateVisuals();
+		firstDraw = true;
+	}
+
+	Color RecyclerListContainer::getBackgroundColor() const noexcept
+	{
+		return backgroundColor;
+	}
+
+	void RecyclerListContainer::setOffset(float offset)
+	{
+		newOffset = offset;
+		invalidate();
+	}
+
+	float RecyclerListContainer::getOffset() const noexcept
+	{
+		return newOffset;
+	}
+
+	void RecyclerListContainer::setPoolSize(size_t size)
+	{
+		poolSize = size;
+		if (pool.size() > poolSize)
+			pool.resize(poolSize);
+	}
+
+	size_t RecyclerListContainer::getPoolSize() const noexcept
+	{
+		return poolSize;
+	}
+
+	Component::Type RecyclerListContainer::getItemView(size_t index) const
+	{
+		if (index < firstItem || index >= firstItem + views.size())
+			return nullptr;
+		return views[index - firstItem];
+	}
+
+	std::pair<size_t, size_t> RecyclerListContainer::getVisibleRange() const noexcept
+	{
+		return std::make_pair(firstItem, firstItem + views.size());
+	}
+
+	float RecyclerListContainer::getItemOffset(size_t index) const
+	{
+		index = std::min(index, sizes.size());
+		return sizes.prefix(index) + unknown.prefix(index) * getEstimatedSize();
+	}
+
+	void RecyclerListContainer::addChild(const Component::Type&)
+	{
+		throw std::logic_error("RecyclerListContainer views are created by adapter");
+	}
+
+	void RecyclerListContainer::removeChild(const Component::Type&)
+	{
+		throw std::logic_error("RecyclerListContainer views are created by adapter");
+	}
+
+	void RecyclerListContainer::clearChildren()
+	{
+		views.clear();
+		pool.clear();
+		viewMapping.clear();
+		toUpdate.clear();
+		toRedraw.clear();
+		firstItem = 0;
+		itemsChanged = true;
+
+		invalidateSpatialIndex();
+		invalidate();
+	}
+
+	void RecyclerListContainer::onMaskDraw(Canvas& canvas) const
+	{
+		if (backgroundColor.a > 0 && firstDraw)
+		{
+			Component::onMaskDraw(canvas);
+		}
+		else
+		{
+			for (const auto& view : views)
+			{
+				if (toRedraw.contains(view.get()))
+					view->drawMask(canvas);
+			}
+
+			//draw mask for free space
+			Rect bounds = getBounds().at(Vec2(0.f, 0.f));
+			float d = 0;
+
+			if (orientation == Orientation::Horizontal)
+			{
+				d = bounds.width;
+				bounds.left += offset + size;
+				bounds.width = d - bounds.left;
+			}
+			else
+			{
+				d = bounds.height;
+				bounds.top += offset + size;
+				bounds.height = d - bounds.top;
+			}
+			if (offset + size < d)
+			{
+				getBackend()->addDamagedRect(bounds);
+			}
+			if (offset > 0)
+			{
+				bounds = getBounds().at(Vec2(0.f, 0.f));
+				if (orientation == Orientation::Horizontal)
+				{
+					bounds.width = offset;
+				}
+				else
+				{
+					bounds.height = offset;
+				}
+				getBackend()->addDamagedRect(bounds);
+			}
+		}
+	}
+
+	void RecyclerListContainer::onDraw(Canvas& canvas)
+	{
+		if (backgroundColor.a > 0 && firstDraw)
+			canvas.drawRectangle(getBounds().at(Vec2(0.f, 0.0f)), backgroundColor);
+		for (const auto& view : views)
+		{
+			if (backgroundColor.a > 0 || toRedraw.contains(view.get()))
+				view->draw(canvas);
+		}
+		toRedraw.clear();
+	}
+
+	void RecyclerListContainer::onRedraw(Canvas& canvas)
+	{
+		if (backgroundColor.a > 0)
+			canvas.drawRectangle(getBounds().at(Vec2(0.f, 0.0f)), backgroundColor);
+		for (const auto& view : views)
+			view->redraw(canvas);
+		toRedraw.clear();
+		firstDraw = false;
+	}
+
+	void RecyclerListContainer::requestRedraw()
+	{
+		Component::requestRedraw();
+		for (const auto& view : views)
+			view->requestRedraw();
+	}
+
+	void RecyclerListContainer::poke()
+	{
+		Rect bounds = getBounds().at({ 0.f, 0.f });
+
+		if (itemsChanged || sizes.size() != (adapter ? adapter->getItemCount() : 0))
+			resetItems();
+
+		//stained views are measured before viewport is filled, bound ones while filling it
+		std::vector<Component*> toPoke;
+		toPoke.reserve(toUpdate.size());
+		for (auto c : toUpdate)
+		{
+			toPoke.emplace_back(c);
+			measureItem(*c, viewMapping.at(c));
+		}
+		toUpdate.clear();
+
+		offset = newOffset;
+		size_t lastFirst = firstItem;
+		size_t lastEnd = firstItem + views.size();
+		bindVisibleItems();
+
+		bool changed = false;
+		float off = getItemOffset(firstItem);
+		for (size_t i = 0; i < views.size(); ++i)
+		{
+			Component& view = *views[i];
+			float s = sizes.get(firstItem + i);
+			if (orientation == Orientation::Horizontal)
+			{
+				bounds.left = off + offset;
+				bounds.width = s;
+			}
+			else
+			{
+				bounds.top = off + offset;
+				bounds.height = s;
+			}
+			off += s;
+
+			bool moved = view.getBounds() != bounds;
+			if (moved)
+				setBounds(view, bounds);
+			if (moved || firstItem + i < lastFirst || firstItem + i >= lastEnd)
+			{
+				toRedraw.insert(&view);
+				changed = true;
+			}
+		}
+		if (changed)
+			Component::requestRedraw();
+
+		//views bound while filling viewport were stained, recycled ones are poked after being bound again
+		for (auto c : toUpdate)
+			toPoke.emplace_back(c);
+		toUpdate.clear();
+		for (auto c : toPoke)
+		{
+			if (viewMapping.count(c))
+				c->poke();
+		}
+
+		//pool is trimmed only now, so views in toPoke stay alive
+		if (pool.size() > poolSize)
+			pool.resize(poolSize);
+
+		//binding invalidates views, so list is marked clean only after it
+		Component::poke();
+	}
+
+	void RecyclerListContainer::onResize(const Rect& lastBounds)
+	{
+		Rect bounds = getBounds();
+		//measured sizes depend on size across the list, size along it only changes number of views
+		if (orientation == Orientation::Horizontal ? bounds.height != lastBounds.height : bounds.width != lastBounds.width)
+			itemsChanged = true;
+		if (bounds.width != lastBounds.width || bounds.height != lastBounds.height)
+			invalidateRecursive();
+	}
+
+	void RecyclerListContainer::onChildStain(Component& c)
+	{
+		if (viewMapping.count(&c))
+			toUpdate.insert(&c);
+	}
+
+	void RecyclerListContainer::onChildNeedsRedraw(Component& c)
+	{
+		if (viewMapping.count(&c))
+			toRedraw.insert(&c);
+	}
+
+	RecyclerListContainer::Iterator RecyclerListContainer::firstElement()
+	{
+		return createIterator<IteratorType>(views.begin(), views.end());
+	}
+
+	void RecyclerListContainer::visitChildren(const ChildVisitor& visitor)
+	{
+		for (const auto& view : views)
+			visitor(*view);
+	}
+
+	std::pair<DimensionDesc, DimensionDesc> RecyclerListContainer::onMeasure(const DimensionDesc& w, const DimensionDesc& h)
+	{
+		std::pair<DimensionDesc, DimensionDesc> measurements = Component::onMeasure(w, h);
+		bool wraps = orientation == Orientation::Horizontal ? getSizingModeHorizontal() == SizingMode::WrapContent : getSizingModeVertical() == SizingMode::WrapContent;
+		if (!wraps)
+			return measurements;
+
+		//sizes are estimated here only when needed, otherwise first layout does it
+		if (itemsChanged || sizes.size() != (adapter ? adapter->getItemCount() : 0))
+			resetItems();
+		if (orientation == Orientation::Horizontal)
+			measurements.first = DimensionDesc(size, DimensionMode::Exact);
+		else
+			measurements.second = DimensionDesc(size, DimensionMode::Exact);
+		return measurements;
+	}
+
+	RecyclerListContainer::RecyclerListContainer() : orientation(Orientation::Vertical), size(0), offset(0), newOffset(0), measuredSum(0), measuredCount(0), itemsChanged(true),
+		firstItem(0), poolSize(8), toUpdate(DirtyList::Kind::Update), toRedraw(DirtyList::Kind::Redraw), backgroundColor(0, 0, 0, 0), firstDraw(true)
+	{
+		useSpatialIndex();
+	}
+
+	RecyclerListContainer::RecyclerListContainer(Manager&, const XML::Tag& tag, const StylingPack& pack) : RecyclerListContainer()
+	{
+		Manager::handleDefaultArguments(*this, tag, pack.style);
+
+		{
+			auto orientation = pack.style.getAttribute("orientation");
+			if (orientation)
+				setOrientation(orientation->as<Orientation>());
+		}
+		{
+			auto background = pack.style.getAttribute("backgroundColor");
+			if (background)
+				setBackgroundColor(background->as<Color>());
+		}
+	}
+
+	void RecyclerListContainer::resetItems()
+	{
+		itemsChanged = false;
+		measuredSum = 0;
+		measuredCount = 0;
+		while (!views.empty())
+		{
+			recycleView(views.back());
+			views.pop_back();
+		}
+		firstItem = 0;
+		invalidateSpatialIndex();
+
+		size_t count = adapter ? adapter->getItemCount() : 0;
+		std::vector<float> estimates(count), unknowns(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			float s = adapter->estimateSize(i);
+			if (s >= 0)
+				estimates[i] = s;
+			else
+				unknowns[i] = 1.f;
+		}
+		sizes.assign(estimates);
+		unknown.assign(unknowns);
+		measured.assign(count, false);
+		size = getTotalSize();
+
+		//without any measured item estimate is unknown, so first item is measured to get it
+		if (unknown.total() > 0)
+		{
+			Component::Type view = obtainView(0);
+			measureItem(*view, 0);
+			recycleView(view);
+		}
+	}
+
+	float RecyclerListContainer::getEstimatedSize() const
+	{
+		return measuredCount > 0 ? static_cast<float>(measuredSum / measuredCount) : 0.f;
+	}
+
+	float RecyclerListContainer::getTotalSize() const
+	{
+		return sizes.total() + unknown.total() * getEstimatedSize();
+	}
+
+	size_t RecyclerListContainer::getItemAt(float offset) const
+	{
+		return std::min(sizes.upperBound(offset, unknown, getEstimatedSize()), sizes.size());
+	}
+
+	void RecyclerListContainer::measureItem(Component& view, size_t index)
+	{
+		Rect bounds = getBounds();
+		DimensionDesc ww(bounds.width, DimensionMode::Max);
+		DimensionDesc hh(bounds.height, DimensionMode::Max);
+
+		if (orientation == Orientation::Horizontal)
+		{
+			ww.value = 0;
+			ww.mode = DimensionMode::Min;
+		}
+		else
+		{
+			hh.value = 0;
+			hh.mode = DimensionMode::Min;
+		}
+
+		auto measurements = view.measure(ww, hh);
+		float s = orientation == Orientation::Horizontal ? measurements.first.value : measurements.second.value;
+		if (!measured[index])
+		{
+			measured[index] = true;
+			measuredSum += s;
+			++measuredCount;
+			if (unknown.get(index) != 0)
+				unknown.set(index, 0.f);
+		}
+		else
+		{
+			measuredSum += s - sizes.get(index);
+		}
+		if (sizes.get(index) != s)
+			sizes.set(index, s);
+		//average of measured sizes moves offsets of all unknown items
+		size = getTotalSize();
+	}
+
+	Component::Type RecyclerListContainer::obtainView(size_t index)
+	{
+		Component::Type view;
+		if (!pool.empty())
+		{
+			view = std::move(pool.back());
+			pool.pop_back();
+			//pooled views do not receive events
+			if (view->getBackend() != getBackend())
+				view->setParent(*this);
+		}
+		else
+		{
+			view = adapter->createView();
+			view->setParent(*this);
+			view->invalidateRecursive();
+		}
+		adapter->bindView(*view, index);
+		return view;
+	}
+
+	void RecyclerListContainer::recycleView(const Component::Type& view)
+	{
+		Component* p = view.get();
+		viewMapping.erase(p);
+		toUpdate.erase(p);
+		toRedraw.erase(p);
+		if (p->isMouseOver())
+			handleEventForComponent(Event::createMouseEvent(Event::MouseEvent::Left, 0, 0, 0), *p);
+		pool.push_back(view);
+	}
+
+	void RecyclerListContainer::bindVisibleItems()
+	{
+		Rect bounds = getBounds();
+		float s = orientation == Orientation::Horizontal ? bounds.width : bounds.height;
+		size_t count = sizes.size();
+
+		std::vector<Component::Type> next;
+		while (true)
+		{
+			//first item ending after start of the view, first item starting after its end
+			float last = s - offset;
+			size_t begin = getItemAt(-offset);
+			size_t end = last < 0 ? 0 : std::min(getItemAt(last) + 1, count);
+			if (begin > end)
+				begin = end;
+
+			size_t lastEnd = firstItem + views.size();
+			if (begin == firstItem && end == lastEnd)
+				break;
+
+			//views leaving viewport are released first, so entering items reuse them
+			for (size_t i = firstItem; i < lastEnd; ++i)
+			{
+				if (i < begin || i >= end)
+					recycleView(views[i - firstItem]);
+			}
+
+			//measured sizes may differ from estimates, so viewport is checked again until it is stable
+			next.clear();
+			next.reserve(end - begin);
+			for (size_t i = begin; i < end; ++i)
+			{
+				if (i >= firstItem && i < lastEnd)
+				{
+					next.push_back(std::move(views[i - firstItem]));
+				}
+				else
+				{
+					next.push_back(obtainView(i));
+					Component& view = *next.back();
+					viewMapping[&view] = i;
+					toUpdate.insert(&view);
+					measureItem(view, i);
+				}
 			}
+			views.swap(next);
+			firstItem = begin;
+			for (size_t i = 0; i < views.size(); ++i)
+				viewMapping[views[i].get()] = firstItem + i;
+			invalidateSpatialIndex();
 		}
-		
-		size = off;
-	}
-
-	ListContainer::Element::Element(const std::shared_ptr<Component>& component, float size, float offset) : component(component), size(size), newSize(size), offset(offset)
-	{
 	}
 
 	
@@ -758,25 +1630,25 @@ namespace Guider
 		flags = (flags & ~EdgeSecondMask) | (start ? 0 : EdgeSecondMask);
 	}
 	
-	std::vector<Component*> ConstraintsContainer::Constraint::getDeps() const
+	std::vector<size_t> ConstraintsContainer::Constraint::getDeps() const
 	{
-		std::vector<Component*> ret;
+		std::vector<size_t> ret;
 
 		switch (getType())
 		{
 		case Type::Regular:
 		{
-			if (regular.left != nullptr)
+			if (regular.left != noSlot)
 				ret.push_back(regular.left);
-			if (regular.right != nullptr)
+			if (regular.right != noSlot)
 				ret.push_back(regular.right);
 			break;
 		}
 		case Type::Chain:
 		{
-			if (chain.left != nullptr)
+			if (chain.left != noSlot)
 				ret.push_back(chain.left);
-			if (chain.right != nullptr)
+			if (chain.right != noSlot)
 				ret.push_back(chain.right);
 			break;
 		}
@@ -785,17 +1657,17 @@ namespace Guider
 		return ret;
 	}
 	
-	bool ConstraintsContainer::Constraint::isFor(const Component& c) const
+	bool ConstraintsContainer::Constraint::isFor(size_t slot) const
 	{
 		switch (getType())
 		{
 		case Type::Regular:
-			return regular.target == &c;
+			return regular.target == slot;
 		case Type::Chain:
 		{
-			for (unsigned i = 2; i < chain.targets.size(); ++i)
+			for (unsigned i = 0; i < chain.targets.size(); ++i)
 			{
-				if (chain.targets[i].first == &c)
+				if (chain.targets[i].first == slot)
 					return true;
 			}
 			return false;
@@ -827,20 +1699,6 @@ namespace Guider
 	
 	ConstraintsContainer::Constraint::Constraint(Constraint&& t) noexcept
 	{
-		switch (getType())
-		{
-		case Type::Regular:
-		{
-			regular.~RegularConstraintData();
-			break;
-		}
-		case Type::Chain:
-		{
-			chain.~ChainConstraintData();
-			break;
-		}
-		}
-
 		switch (t.getType())
 		{
 		case Type::Regular:
@@ -881,47 +1739,51 @@ namespace Guider
 	void ConstraintsContainer::RegularConstraintBuilder::setSize(float size)
 	{
 		constraint.regular.size = size;
+		container.markDirty(*cluster);
+		container.invalidLayout = true;
 	}
 	
 	void ConstraintsContainer::RegularConstraintBuilder::setFlow(float flow)
 	{
 		constraint.regular.flow = flow;
+		container.markDirty(*cluster);
+		container.invalidLayout = true;
 	}
 	
 	void ConstraintsContainer::RegularConstraintBuilder::attachStartTo(const Component::Type& target, bool toStart, float offset)
 	{
-		constraint.regular.leftOffset = offset;
-		constraint.setFirstEdge(toStart);
+		size_t slot = container.slotOf(target.get());
+		if (slot != noSlot)
+			container.addDependency(*cluster, slot);
 
-		Component* prevLeft = constraint.regular.left;
+		size_t prevLeft = constraint.regular.left;
+		if (prevLeft != noSlot)
+			container.removeDependency(*cluster, prevLeft);
 
-		constraint.regular.left = target.get();
-		cluster->dependencies[constraint.regular.left]++;
+		constraint.regular.left = slot;
+		constraint.regular.leftOffset = offset;
+		constraint.setFirstEdge(toStart);
 
-		if (prevLeft != nullptr)
-		{
-			cluster->dependencies.at(prevLeft)--;
-			if (cluster->dependencies.at(prevLeft) == 0)
-				cluster->dependencies.erase(prevLeft);
-		}
+		container.markDirty(*cluster);
+		container.invalidLayout = true;
 	}
 	
 	void ConstraintsContainer::RegularConstraintBuilder::attachEndTo(const Component::Type& target, bool toStart, float offset)
 	{
-		constraint.regular.rightOffset = offset;
-		constraint.setSecondEdge(toStart);
+		size_t slot = container.slotOf(target.get());
+		if (slot != noSlot)
+			container.addDependency(*cluster, slot);
 
-		Component* prevRight = constraint.regular.right;
+		size_t prevRight = constraint.regular.right;
+		if (prevRight != noSlot)
+			container.removeDependency(*cluster, prevRight);
 
-		constraint.regular.right = target.get();
-		cluster->dependencies[constraint.regular.right]++;
+		constraint.regular.right = slot;
+		constraint.regular.rightOffset = offset;
+		constraint.setSecondEdge(toStart);
 
-		if (prevRight != nullptr)
-		{
-			cluster->dependencies.at(prevRight)--;
-			if (cluster->dependencies.at(prevRight) == 0)
-				cluster->dependencies.erase(prevRight);
-		}
+		container.markDirty(*cluster);
+		container.invalidLayout = true;
 	}
 	
 	void ConstraintsContainer::RegularConstraintBuilder::attachLeftTo(const Component::Type& target, bool toLeft, float offset)
@@ -957,159 +1819,296 @@ namespace Guider
 
 	void ConstraintsContainer::RegularConstraintBuilder::applyChanges()
 	{
-		Component* c = constraint.regular.target;
+		Component* c = container.slotComponents[constraint.regular.target];
 		c->getParent()->onChildStain(*c);
 	}
 
 
 	void ConstraintsContainer::ChainConstraintBuilder::attachStartTo(const Component::Type& target, bool toStart, float offset)
 	{
-		constraint.chain.leftOffset = offset;
-		constraint.setFirstEdge(toStart);
+		size_t slot = container.slotOf(target.get());
+		if (slot != noSlot)
+			container.addDependency(*cluster, slot);
 
-		Component* prevLeft = constraint.chain.left;
+		size_t prevLeft = constraint.chain.left;
+		if (prevLeft != noSlot)
+			container.removeDependency(*cluster, prevLeft);
 
-		constraint.chain.left = target.get();
-		cluster->dependencies[constraint.chain.left]++;
+		constraint.chain.left = slot;
+		constraint.chain.leftOffset = offset;
+		constraint.setFirstEdge(toStart);
 
-		if (prevLeft != nullptr)
-		{
-			cluster->dependencies.at(prevLeft)--;
-			if (cluster->dependencies.at(prevLeft) == 0)
-				cluster->dependencies.erase(prevLeft);
-		}
+		container.markDirty(*cluster);
+		container.invalidLayout = true;
 	}
 	
 	void ConstraintsContainer::ChainConstraintBuilder::attachEndTo(const Component::Type& target, bool toStart, float offset)
 	{
-		constraint.chain.rightOffset = offset;
-		constraint.setSecondEdge(toStart);
+		size_t slot = container.slotOf(target.get());
+		if (slot != noSlot)
+			container.addDependency(*cluster, slot);
 
-		Component* prevRight = constraint.chain.right;
+		size_t prevRight = constraint.chain.right;
+		if (prevRight != noSlot)
+			container.removeDependency(*cluster, prevRight);
 
-		constraint.chain.right = target.get();
-		cluster->dependencies[constraint.chain.right]++;
+		constraint.chain.right = slot;
+		constraint.chain.rightOffset = offset;
+		constraint.setSecondEdge(toStart);
 
-		if (prevRight != nullptr)
-		{
-			cluster->dependencies.at(prevRight)--;
-			if (cluster->dependencies.at(prevRight) == 0)
-				cluster->dependencies.erase(prevRight);
-		}
+		container.markDirty(*cluster);
+		container.invalidLayout = true;
 	}
 	
 
-	float ConstraintsContainer::getEdge(Component* c, Constraint::Edge e)
+	size_t ConstraintsContainer::slotOf(const Component* c)
 	{
-		Rect rect;
 		if (c == nullptr)
+			return noSlot;
+
+		auto it = slots.find(c);
+		if (it != slots.end())
+			return it->second;
+
+		size_t slot;
+		if (!freeSlots.empty())
 		{
-			rect = Rect(0, 0, 0, 0);
+			slot = freeSlots.back();
+			freeSlots.pop_back();
 		}
 		else
 		{
-			rect = boundaries[c];
-		}
-		if (c == this)
-		{
-			rect.left = 0;
-			rect.top = 0;
+			slot = slotComponents.size();
+			slotLeft.emplace_back();
+			slotTop.emplace_back();
+			slotWidth.emplace_back();
+			slotHeight.emplace_back();
+			slotComponents.emplace_back();
+			slotClusters.emplace_back();
+			slotDependents.emplace_back();
 		}
+		setSlotBounds(slot, Rect(0, 0, 0, 0));
+		slotComponents[slot] = const_cast<Component*>(c);
+		slotClusters[slot] = clusters.end();
+		slots.emplace(c, slot);
+		return slot;
+	}
+
+	void ConstraintsContainer::releaseSlot(size_t slot)
+	{
+		slots.erase(slotComponents[slot]);
+		slotComponents[slot] = nullptr;
+		slotClusters[slot] = clusters.end();
+		slotDependents[slot].clear();
+		freeSlots.push_back(slot);
+	}
+
+	Rect ConstraintsContainer::getSlotBounds(size_t slot) const
+	{
+		return Rect(slotLeft[slot], slotTop[slot], slotWidth[slot], slotHeight[slot]);
+	}
+
+	void ConstraintsContainer::setSlotBounds(size_t slot, const Rect& bounds)
+	{
+		slotLeft[slot] = bounds.left;
+		slotTop[slot] = bounds.top;
+		slotWidth[slot] = bounds.width;
+		slotHeight[slot] = bounds.height;
+	}
+
+	float ConstraintsContainer::getEdge(size_t slot, Constraint::Edge e) const
+	{
+		if (slot == noSlot)
+			return 0;
 
 		switch (e)
 		{
 		case Constraint::Edge::Left:
-			return rect.left;
+			return slotLeft[slot];
 		case Constraint::Edge::Right:
-			return rect.left + rect.width;
+			return slotLeft[slot] + slotWidth[slot];
 		case Constraint::Edge::Top:
-			return rect.top;
+			return slotTop[slot];
 		case Constraint::Edge::Bottom:
-			return rect.top + rect.height;
+			return slotTop[slot] + slotHeight[slot];
 		}
 		return 0;
 	}
 	
-	bool ConstraintsContainer::reorderClusters()
+	bool ConstraintsContainer::isLaterInOrder(const Cluster* a, const Cluster* b)
 	{
-		updated.clear();
-		size_t n = clusters.size();
-		//number of references i have
-		std::unordered_map<std::list<Cluster>::iterator, unsigned, ClusterHash> ndeps;
+		return a->order > b->order;
+	}
 
-		//list of elements dependent on me
-		std::unordered_map<std::list<Cluster>::iterator, std::unordered_set<std::list<Cluster>::iterator, ClusterHash>, ClusterHash> clusterDependencies;
+	std::list<ConstraintsContainer::Cluster>::iterator ConstraintsContainer::createCluster()
+	{
+		clusters.emplace_back();
+		auto cluster = std::prev(clusters.end());
+		cluster->order = orderedClusters.size();
+		orderedClusters.push_back(&(*cluster));
+		return cluster;
+	}
 
-		for (auto it = clusters.begin(); it != clusters.end(); ++it)
+	void ConstraintsContainer::eraseCluster(std::list<Cluster>::iterator cluster)
+	{
+		if (cluster->dirty)
+		{
+			dirtyClusters.erase(std::find(dirtyClusters.begin(), dirtyClusters.end(), &(*cluster)));
+			std::make_heap(dirtyClusters.begin(), dirtyClusters.end(), isLaterInOrder);
+		}
+		for (auto i : cluster->components)
 		{
-			ndeps[it] = 0;
+			if (slotClusters[i] == cluster)
+				slotClusters[i] = clusters.end();
 		}
+		orderedClusters[cluster->order] = nullptr;
+		++emptyOrders;
+		clusters.erase(cluster);
+
+		if (emptyOrders * 2 > orderedClusters.size())
+			compactOrder();
+	}
+
+	void ConstraintsContainer::addComponent(std::list<Cluster>::iterator cluster, size_t slot)
+	{
+		for (auto dependent : slotDependents[slot])
+			orderAfter(*cluster, *dependent);
+		cluster->components.push_back(slot);
+		slotClusters[slot] = cluster;
+	}
+
+	void ConstraintsContainer::addDependency(Cluster& cluster, size_t slot)
+	{
+		auto source = slotClusters[slot];
+		if (source != clusters.end())
+			orderAfter(*source, cluster);
+		cluster.dependencies[slot]++;
+		slotDependents[slot].push_back(&cluster);
+	}
+
+	void ConstraintsContainer::removeDependency(Cluster& cluster, size_t slot)
+	{
+		auto dependency = cluster.dependencies.find(slot);
+		if (--dependency->second == 0)
+			cluster.dependencies.erase(dependency);
+
+		auto& dependents = slotDependents[slot];
+		auto it = std::find(dependents.begin(), dependents.end(), &cluster);
+		*it = dependents.back();
+		dependents.pop_back();
+	}
 
-		for (auto cluster = clusters.begin(); cluster != clusters.end(); ++cluster)
+	template<typename Visitor>
+	void ConstraintsContainer::forEachDependent(const Cluster& cluster, Visitor&& visitor)
+	{
+		for (auto component : cluster.components)
 		{
-			for (const auto& dep : cluster->dependencies)
+			for (auto dependent : slotDependents[component])
 			{
-				auto mapping = clusterMapping.find(dep.first);
-
-				if (mapping != clusterMapping.end())
-				{
-					ndeps[cluster]++;
-					clusterDependencies[mapping->second].insert(cluster);
-				}
-				else if (dep.first != this)
-					throw std::runtime_error("Internal error");
+				if (dependent != &cluster)
+					visitor(*dependent);
 			}
 		}
+	}
 
-		// Create an queue and enqueue all vertices with 
-		// depth 0 
-		std::queue<std::list<Cluster>::iterator> q;
-
-		for (auto it = clusters.begin(); it != clusters.end(); ++it)
+	template<typename Visitor>
+	void ConstraintsContainer::forEachDependency(const Cluster& cluster, Visitor&& visitor)
+	{
+		for (const auto& dependency : cluster.dependencies)
 		{
-			if (ndeps[it] == 0)
-				q.push(it);
+			auto source = slotClusters[dependency.first];
+			if (source != clusters.end() && &(*source) != &cluster)
+				visitor(*source);
 		}
+	}
 
-		unsigned cnt = 0;
-
-		std::unordered_set<std::list<Cluster>::iterator, ClusterHash> visited;
-		std::vector<Cluster*> ret;
+	void ConstraintsContainer::orderAfter(Cluster& source, Cluster& target)
+	{
+		if (&source == &target)
+			throw std::logic_error("ConstraintsContainer constraint depends on its own cluster");
+		if (source.order < target.order)
+			return;
 
-		ret.reserve(n);
+		//Pearce-Kelly: only clusters reachable from target that precede source
+		//and clusters reaching source that follow target are reordered
+		size_t lower = target.order, upper = source.order;
+		uint64_t mark = ++searchMark;
 
-		while (!q.empty())
+		forwardSearch.clear();
+		forwardSearch.push_back(&target);
+		target.visited = mark;
+		for (size_t i = 0; i < forwardSearch.size(); ++i)
 		{
-			auto front = q.front();
-			q.pop();
-			ret.emplace_back(&(*front));
-			auto& clusterDependency = clusterDependencies[front];
-			for (const auto& it : clusterDependency)
-				if (--ndeps[it] == 0)
-					q.push(it);
+			forEachDependent(*forwardSearch[i], [&](Cluster& c) {
+				if (&c == &source)
+					throw std::logic_error("ConstraintsContainer constraints form a dependency cycle");
+				if (c.visited != mark && c.order < upper)
+				{
+					c.visited = mark;
+					forwardSearch.push_back(&c);
+				}
+				});
+		}
 
-			cnt++;
+		backwardSearch.clear();
+		backwardSearch.push_back(&source);
+		source.visited = mark;
+		for (size_t i = 0; i < backwardSearch.size(); ++i)
+		{
+			forEachDependency(*backwardSearch[i], [&](Cluster& c) {
+				if (c.visited != mark && c.order > lower)
+				{
+					c.visited = mark;
+					backwardSearch.push_back(&c);
+				}
+				});
 		}
 
-		if (cnt != n)
+		//freed positions are given to clusters reaching source first, then to ones reachable from target
+		std::vector<size_t> orders;
+		orders.reserve(forwardSearch.size() + backwardSearch.size());
+		for (auto c : backwardSearch)
+			orders.push_back(c->order);
+		for (auto c : forwardSearch)
+			orders.push_back(c->order);
+		std::sort(orders.begin(), orders.end());
+
+		auto byOrder = [](const Cluster* a, const Cluster* b) {
+			return a->order < b->order;
+		};
+		std::sort(backwardSearch.begin(), backwardSearch.end(), byOrder);
+		std::sort(forwardSearch.begin(), forwardSearch.end(), byOrder);
+
+		size_t next = 0;
+		for (auto c : backwardSearch)
 		{
-			return false;
+			c->order = orders[next++];
+			orderedClusters[c->order] = c;
+		}
+		for (auto c : forwardSearch)
+		{
+			c->order = orders[next++];
+			orderedClusters[c->order] = c;
 		}
 
-		std::list<Cluster> tmp;
+		if (!dirtyClusters.empty())
+			std::make_heap(dirtyClusters.begin(), dirtyClusters.end(), isLaterInOrder);
+	}
 
-		for (auto i : ret)
+	void ConstraintsContainer::compactOrder()
+	{
+		//relative order is kept, so dirty clusters stay a valid heap
+		size_t n = 0;
+		for (auto cluster : orderedClusters)
 		{
-			for (auto j : i->components)
+			if (cluster != nullptr)
 			{
-				updated.insert(j);
+				cluster->order = n;
+				orderedClusters[n++] = cluster;
 			}
-			tmp.emplace_back(std::move(const_cast<Cluster&>(*i)));
 		}
-
-		clusters = std::move(tmp);
-
-		return true;
+		orderedClusters.resize(n);
+		emptyOrders = 0;
 	}
 	
 	void ConstraintsContainer::solveConstraint(const Constraint& c, Constraint::PassType pass)
@@ -1118,9 +2117,9 @@ namespace Guider
 		{
 		case Constraint::Type::Regular:
 		{
-			Component* start = c.regular.left;
+			size_t start = c.regular.left;
 			float soff = c.regular.leftOffset;
-			Component* end = c.regular.right;
+			size_t end = c.regular.right;
 			float eoff = c.regular.rightOffset;
 
 			float s = getEdge(start, c.getFirstEdge()) + soff;
@@ -1133,7 +2132,7 @@ namespace Guider
 				e = tmp;
 			}
 
-			Rect& out = boundaries[c.regular.target];
+			size_t out = c.regular.target;
 
 			switch (pass)
 			{
@@ -1151,13 +2150,13 @@ namespace Guider
 				}
 				if (c.getOrientation() == Orientation::Horizontal)
 				{
-					out.left = s;
-					out.width = size;
+					slotLeft[out] = s;
+					slotWidth[out] = size;
 				}
 				else
 				{
-					out.top = s;
-					out.height = size;
+					slotTop[out] = s;
+					slotHeight[out] = size;
 				}
 				break;
 			}
@@ -1165,11 +2164,11 @@ namespace Guider
 			{
 				if (c.getOrientation() == Orientation::Horizontal)
 				{
-					out.left = s * (1 - c.regular.flow) + (e - out.width) * c.regular.flow;
+					slotLeft[out] = s * (1 - c.regular.flow) + (e - slotWidth[out]) * c.regular.flow;
 				}
 				else
 				{
-					out.top = s * (1 - c.regular.flow) + (e - out.height) * c.regular.flow;
+					slotTop[out] = s * (1 - c.regular.flow) + (e - slotHeight[out]) * c.regular.flow;
 				}
 				break;
 			}
@@ -1180,9 +2179,9 @@ namespace Guider
 		{
 			if (c.chain.targets.size() < 3)
 				return;
-			Component* start = c.chain.left;
+			size_t start = c.chain.left;
 			float soff = c.chain.leftOffset;
-			Component* end = c.chain.right;
+			size_t end = c.chain.right;
 			float eoff = c.chain.rightOffset;
 
 			float s = getEdge(start, c.getFirstEdge()) + soff;
@@ -1207,14 +2206,14 @@ namespace Guider
 				}
 				case Constraint::PassType::Final:
 				{
-					Rect& bounds = boundaries[c.chain.targets[j].first];
+					size_t slot = c.chain.targets[j].first;
 					if (c.getOrientation() == Orientation::Horizontal)
 					{
-						width += bounds.width;
+						width += slotWidth[slot];
 					}
 					else
 					{
-						width += bounds.height;
+						width += slotHeight[slot];
 					}
 					break;
 				}
@@ -1261,28 +2260,29 @@ namespace Guider
 					}
 					case Constraint::PassType::Final:
 					{
-						Rect& bounds = boundaries[c.chain.targets[i].first];
+						size_t slot = c.chain.targets[i].first;
 						if (c.getOrientation() == Orientation::Horizontal)
 						{
-							size = bounds.width;
+							size = slotWidth[slot];
 						}
 						else
 						{
-							size = bounds.height;
+							size = slotHeight[slot];
 						}
 						break;
 					}
 					}
 
+					size_t slot = c.chain.targets[i].first;
 					if (c.getOrientation() == Orientation::Horizontal)
 					{
-						boundaries[c.chain.targets[i].first].left = sp;
-						boundaries[c.chain.targets[i].first].width = size;
+						slotLeft[slot] = sp;
+						slotWidth[slot] = size;
 					}
 					else
 					{
-						boundaries[c.chain.targets[i].first].top = sp;
-						boundaries[c.chain.targets[i].first].height = size;
+						slotTop[slot] = sp;
+						slotHeight[slot] = size;
 					}
 					sp += spacing + size;
 				}
@@ -1306,28 +2306,29 @@ namespace Guider
 					}
 					case Guider::ConstraintsContainer::Constraint::PassType::Final:
 					{
-						Rect& bounds = boundaries[c.chain.targets[i].first];
+						size_t slot = c.chain.targets[i].first;
 						if (c.getOrientation() == Orientation::Horizontal)
 						{
-							size = bounds.width;
+							size = slotWidth[slot];
 						}
 						else
 						{
-							size = bounds.height;
+							size = slotHeight[slot];
 						}
 						break;
 					}
 					}
 
+					size_t slot = c.chain.targets[i].first;
 					if (c.getOrientation() == Orientation::Horizontal)
 					{
-						boundaries[c.chain.targets[i].first].left = sp;
-						boundaries[c.chain.targets[i].first].width = size;
+						slotLeft[slot] = sp;
+						slotWidth[slot] = size;
 					}
 					else
 					{
-						boundaries[c.chain.targets[i].first].top = sp;
-						boundaries[c.chain.targets[i].first].height = size;
+						slotTop[slot] = sp;
+						slotHeight[slot] = size;
 					}
 
 					sp += spacing + size;
@@ -1349,17 +2350,18 @@ namespace Guider
 		}
 		for (const auto i : cluster.components) // ask elements for their bounds
 		{
-			if (i != this)
+			if (i != 0)
 			{
-				Rect& bounds = boundaries[i];
-				std::pair<DimensionDesc, DimensionDesc> measures = i->measure(
-					DimensionDesc(bounds.width, DimensionMode::Max),
-					DimensionDesc(bounds.height, DimensionMode::Max)
+				float& width = slotWidth[i];
+				float& height = slotHeight[i];
+				std::pair<DimensionDesc, DimensionDesc> measures = slotComponents[i]->measure(
+					DimensionDesc(width, DimensionMode::Max),
+					DimensionDesc(height, DimensionMode::Max)
 				);
-				if (measures.first.value < bounds.width)
-					bounds.width = measures.first.value;
-				if (measures.second.value < bounds.height)
-					bounds.height = measures.second.value;
+				if (measures.first.value < width)
+					width = measures.first.value;
+				if (measures.second.value < height)
+					height = measures.second.value;
 			}
 		}
 		for (const auto constraint : cluster.constraints) // calculate final bounds
@@ -1368,6 +2370,137 @@ namespace Guider
 		}
 	}
 	
+	void ConstraintsContainer::markDirty(Cluster& cluster)
+	{
+		if (!cluster.dirty)
+		{
+			cluster.dirty = true;
+			dirtyClusters.push_back(&cluster);
+			std::push_heap(dirtyClusters.begin(), dirtyClusters.end(), isLaterInOrder);
+		}
+	}
+
+	void ConstraintsContainer::recordBounds(const Cluster& cluster)
+	{
+		for (auto i : cluster.components)
+			solvedBounds.push_back(getSlotBounds(i));
+	}
+
+	void ConstraintsContainer::commitCluster(Cluster& cluster, size_t recorded)
+	{
+		cluster.dirty = false;
+
+		for (size_t i = 0; i < cluster.components.size(); ++i)
+		{
+			size_t slot = cluster.components[i];
+			if (getSlotBounds(slot) != solvedBounds[recorded + i])
+			{
+				changedSlots.push_back(slot);
+				for (auto dependent : slotDependents[slot])
+				{
+					if (dependent != &cluster)
+						markDirty(*dependent);
+				}
+			}
+		}
+	}
+
+	void ConstraintsContainer::updateCluster(Cluster& cluster)
+	{
+		solvedBounds.clear();
+		recordBounds(cluster);
+		solveCluster(cluster);
+		commitCluster(cluster, 0);
+	}
+
+	void ConstraintsContainer::solveLevels()
+	{
+		//clusters which may need solving, in order of dependencies
+		uint64_t mark = ++searchMark;
+		forwardSearch.clear();
+		if (fullLayout)
+		{
+			for (auto cluster : orderedClusters)
+			{
+				if (cluster != nullptr)
+				{
+					cluster->visited = mark;
+					forwardSearch.push_back(cluster);
+				}
+			}
+		}
+		else
+		{
+			for (auto cluster : dirtyClusters)
+			{
+				cluster->visited = mark;
+				forwardSearch.push_back(cluster);
+			}
+			for (size_t i = 0; i < forwardSearch.size(); ++i)
+			{
+				forEachDependent(*forwardSearch[i], [&](Cluster& c) {
+					if (c.visited != mark)
+					{
+						c.visited = mark;
+						forwardSearch.push_back(&c);
+					}
+					});
+			}
+			std::sort(forwardSearch.begin(), forwardSearch.end(), [](const Cluster* a, const Cluster* b) {
+				return a->order < b->order;
+				});
+		}
+
+		//clusters of single level depend only on earlier levels, so they can be solved concurrently
+		size_t depth = 0;
+		for (auto cluster : forwardSearch)
+		{
+			size_t level = 0;
+			forEachDependency(*cluster, [&](Cluster& c) {
+				if (c.visited == mark && c.level >= level)
+					level = c.level + 1;
+				});
+			cluster->level = level;
+			if (level >= depth)
+			{
+				depth = level + 1;
+				if (levels.size() < depth)
+					levels.resize(depth);
+				levels[level].clear();
+			}
+			levels[level].push_back(cluster);
+		}
+
+		for (size_t l = 0; l < depth; ++l)
+		{
+			std::vector<Cluster*>& level = levels[l];
+			//on partial layout only clusters changed by earlier levels are solved
+			if (!fullLayout)
+			{
+				level.erase(std::remove_if(level.begin(), level.end(), [](const Cluster* c) {
+					return !c->dirty;
+					}), level.end());
+			}
+
+			solvedBounds.clear();
+			solvedOffsets.clear();
+			for (auto cluster : level)
+			{
+				solvedOffsets.push_back(solvedBounds.size());
+				recordBounds(*cluster);
+			}
+
+			threadPool->run(level.size(), [this, &level](size_t i) {
+				solveCluster(*level[i]);
+				});
+
+			//committed serially in order of dependencies, just like serial layout does
+			for (size_t i = 0; i < level.size(); ++i)
+				commitCluster(*level[i], solvedOffsets[i]);
+		}
+		dirtyClusters.clear();
+	}
+	
 	void ConstraintsContainer::solveConstraints()
 	{
 		Rect bounds = getBounds();
@@ -1376,13 +2509,6 @@ namespace Guider
 	
 	void ConstraintsContainer::solveConstraints(const DimensionDesc& w, const DimensionDesc& h)
 	{
-		if (messyClusters)
-		{
-			if (!reorderClusters())
-				return;
-			messyClusters = false;
-		}
-		std::unordered_map<Component*, Rect> lastBoundaries = boundaries;
 
 		Rect bounds;
 		Rect parentBounds;
@@ -1446,27 +2572,68 @@ namespace Guider
 			bounds.height = bounds.height >= h.value ? bounds.height : h.value; break;
 		}
 
-		boundaries[this] = bounds;
+		bounds.left = 0;
+		bounds.top = 0;
+		if (getSlotBounds(0) != bounds)
+		{
+			setSlotBounds(0, bounds);
+			fullLayout = true;
+		}
 
-		for (const auto& cluster : clusters)
+		if (threadPool != nullptr && !ThreadPool::isRunningTask() && (fullLayout || dirtyClusters.size() >= parallelDirtyClusters))
+		{
+			solveLevels();
+		}
+		else if (fullLayout)
+		{
+			for (auto cluster : orderedClusters)
+			{
+				if (cluster != nullptr)
+					updateCluster(*cluster);
+			}
+			dirtyClusters.clear();
+		}
+		else
 		{
-			solveCluster(cluster);
+			//dependents come later in order, so only clusters depending on changed ones are visited
+			while (!dirtyClusters.empty())
+			{
+				std::pop_heap(dirtyClusters.begin(), dirtyClusters.end(), isLaterInOrder);
+				Cluster* cluster = dirtyClusters.back();
+				dirtyClusters.pop_back();
+				updateCluster(*cluster);
+			}
 		}
 	}
 	
 	void ConstraintsContainer::applyConstraints()
 	{
-		for (auto it = children.begin(); it != children.end(); ++it)
-		{
-			const auto& child = *it;
-			Component* p = child.get();
-			if (p->getBounds() != boundaries[p])
+		auto apply = [this](Component* p, size_t slot) {
+			Rect bounds = getSlotBounds(slot);
+			if (p->getBounds() != bounds)
 			{
-				drawnLastFrame[p] = p->getBounds();
-				setBounds(*p, boundaries[p]);
+				//first bounds are the drawn ones when moved more times between frames
+				drawnLastFrame.emplace(p, p->getBounds());
+				setBounds(*p, bounds);
 			}
+		};
 
+		if (fullLayout)
+		{
+			for (size_t i = 0; i < children.size(); ++i)
+				apply(children[i].get(), childSlots[i]);
+		}
+		else
+		{
+			for (auto slot : changedSlots)
+			{
+				Component* p = slotComponents[slot];
+				if (slot != 0 && p != nullptr && p->getParent() == this)
+					apply(p, slot);
+			}
 		}
+		changedSlots.clear();
+		fullLayout = false;
 		invalidLayout = false;
 	}
 	
@@ -1483,6 +2650,16 @@ namespace Guider
 		firstDraw = true;
 		invalidateVisuals();
 	}
+
+	void ConstraintsContainer::setThreadPool(const std::shared_ptr<ThreadPool>& pool)
+	{
+		threadPool = pool;
+	}
+
+	const std::shared_ptr<ThreadPool>& ConstraintsContainer::getThreadPool() const noexcept
+	{
+		return threadPool;
+	}
 	
 	void ConstraintsContainer::poke()
 	{
@@ -1493,7 +2670,11 @@ namespace Guider
 			solveConstraints();
 			applyConstraints();
 		}
-		for (auto& i : children)
+
+		//only stained children can be unclean
+		std::vector<Component*> toPoke(updated.begin(), updated.end());
+		updated.clear();
+		for (auto i : toPoke)
 		{
 			if (!i->isClean())
 				i->poke();
@@ -1512,12 +2693,16 @@ namespace Guider
 	
 	void ConstraintsContainer::onChildStain(Component& c)
 	{
+		updated.insert(&c);
 		Rect pbounds = getBounds().at(Vec2(0.f, 0.f));
-		Rect bounds = boundaries[&c];
+		size_t slot = slotOf(&c);
+		Rect bounds = getSlotBounds(slot);
 		std::pair<DimensionDesc, DimensionDesc> measurements = c.measure(DimensionDesc(pbounds.width, DimensionMode::Max), DimensionDesc(pbounds.height, DimensionMode::Max));
 		if (measurements.first.value != bounds.width || measurements.second.value != bounds.height)
 		{
 			invalidLayout = true;
+			if (slotClusters[slot] != clusters.end())
+				markDirty(*slotClusters[slot]);
 		}
 	}
 	
@@ -1533,6 +2718,7 @@ namespace Guider
 		case Event::Type::BackendConnected:
 		{
 			invalidLayout = true;
+			fullLayout = true;
 			break;
 		}
 		case Event::Type::Invalidated:
@@ -1545,11 +2731,11 @@ namespace Guider
 		return Container::handleEvent(event);
 	}
 	
-	std::pair<DimensionDesc, DimensionDesc> ConstraintsContainer::measure(const DimensionDesc& w, const DimensionDesc& h)
+	std::pair<DimensionDesc, DimensionDesc> ConstraintsContainer::onMeasure(const DimensionDesc& w, const DimensionDesc& h)
 	{
-		Rect bounds = boundaries[this];
+		Rect bounds = getSlotBounds(0);
 		float ws = bounds.width, hs = bounds.height;
-		auto measurements = Component::measure(w, h);
+		auto measurements = Component::onMeasure(w, h);
 		bool recalcLayout = false;
 		if (getSizingModeVertical() == SizingMode::WrapContent)
 		{
@@ -1589,7 +2775,7 @@ namespace Guider
 		{
 			solveConstraints(w, h);
 			invalidLayout = false;
-			bounds = boundaries[this];
+			bounds = getSlotBounds(0);
 			if (getSizingModeHorizontal() == SizingMode::WrapContent)
 			{
 				ws = bounds.width;
@@ -1611,17 +2797,21 @@ namespace Guider
 		Component* p = child.get();
 		if (it != children.end())
 		{
+			size_t index = it - children.begin();
+			size_t slot = childSlots[index];
+
 			//find and delete cluster
-			auto cit = clusterMapping.find(p);
-			if (cit != clusterMapping.end())
+			auto cluster = slotClusters[slot];
+			if (cluster != clusters.end())
 			{
-				if (!cit->second->components.count(p))
+				auto component = std::find(cluster->components.begin(), cluster->components.end(), slot);
+				if (component == cluster->components.end())
 					throw std::runtime_error("Internal ConstraintsContainer error(cluster mapping desync)");
-				cit->second->components.erase(p);
+				cluster->components.erase(component);
 				std::vector<Constraint*> constraintsToRemove;
-				for (auto constraint : cit->second->constraints)
+				for (auto constraint : cluster->constraints)
 				{
-					if (constraint->isFor(*p))
+					if (constraint->isFor(slot))
 					{
 						switch (constraint->getType())
 						{
@@ -1633,8 +2823,8 @@ namespace Guider
 						}
 						case Constraint::Type::Chain:
 						{
-							auto toRemove = std::remove_if(constraint->chain.targets.begin(), constraint->chain.targets.end(), [p](const std::pair<Component*, float>& a) {
-								return a.first == p;
+							auto toRemove = std::remove_if(constraint->chain.targets.begin(), constraint->chain.targets.end(), [slot](const std::pair<size_t, float>& a) {
+								return a.first == slot;
 								});
 							constraint->chain.targets.erase(toRemove,constraint->chain.targets.end());
 							if (constraint->chain.targets.empty())
@@ -1653,31 +2843,68 @@ namespace Guider
 				for (auto constraint : constraintsToRemove)
 				{
 					//remove dependency reference from cluster
-					std::vector<Component*> deps = constraint->getDeps();
+					std::vector<size_t> deps = constraint->getDeps();
 					for (auto dep : deps)
-						cit->second->dependencies.at(dep)--;
-					cit->second->constraints.erase(constraint);
+						removeDependency(*cluster, dep);
+					cluster->constraints.erase(std::find(cluster->constraints.begin(), cluster->constraints.end(), constraint));
+					constraints.remove_if([constraint](const Constraint& c) {
+						return &c == constraint;
+						});
 				}
 
 				//remove cluster if empty
-				if (cit->second->constraints.empty())
-				{
-					clusters.erase(cit->second);
-				}
+				if (cluster->constraints.empty())
+					eraseCluster(cluster);
 				else
+					markDirty(*cluster);
+
+				invalidate();
+			}
+
+			//attachments to removed child are dropped, so its slot can be reused
+			auto detach = [this, slot](size_t& attachment, size_t target) {
+				if (attachment != slot)
+					return;
+				attachment = noSlot;
+				auto owner = slotClusters[target];
+				removeDependency(*owner, slot);
+				markDirty(*owner);
+			};
+			for (auto& constraint : constraints)
+			{
+				switch (constraint.getType())
 				{
-					//otherwise remove handing dependencies
-					std::vector<Component*> dependenciesToRemove;
-					for (const auto& i : cit->second->dependencies)
-						if (i.second == 0)
-							dependenciesToRemove.push_back(i.first);
-					for (auto i : dependenciesToRemove)
-						cit->second->dependencies.erase(i);
+				case Constraint::Type::Regular:
+					detach(constraint.regular.left, constraint.regular.target);
+					detach(constraint.regular.right, constraint.regular.target);
+					break;
+				case Constraint::Type::Chain:
+					detach(constraint.chain.left, constraint.chain.targets.front().first);
+					detach(constraint.chain.right, constraint.chain.targets.front().first);
+					break;
+				default:
+					break;
 				}
+			}
 
-				invalidate();
+			Rect last = p->getBounds();
+			auto drawn = drawnLastFrame.find(p);
+			if (drawn != drawnLastFrame.end())
+			{
+				last = drawn->second;
+				drawnLastFrame.erase(drawn);
 			}
+			needsRedraw.erase(p);
+			updated.erase(p);
 			children.erase(it);
+			childSlots.erase(childSlots.begin() + index);
+			releaseSlot(slot);
+			invalidateSpatialIndex();
+			invalidLayout = true;
+
+			//area of removed child is drawn again
+			exposed.push_back(last);
+			Component::requestRedraw();
 		}
 
 	}
@@ -1685,30 +2912,51 @@ namespace Guider
 	void ConstraintsContainer::clearChildren()
 	{
 		//basics
-		Rect bounds = boundaries[this];
+		Rect bounds = getSlotBounds(0);
 		children.clear();
-		boundaries.clear();
-		boundaries[this] = bounds;
+		childSlots.clear();
 
 		//constraints & clusters
 		constraints.clear();
 		clusters.clear();
-		clusterMapping.clear();
-		messyClusters = true;
+		orderedClusters.clear();
+		emptyOrders = 0;
+		dirtyClusters.clear();
+		changedSlots.clear();
+
+		//layout storage
+		slotLeft.resize(1);
+		slotTop.resize(1);
+		slotWidth.resize(1);
+		slotHeight.resize(1);
+		slotComponents.resize(1);
+		slotClusters.assign(1, clusters.end());
+		slotDependents.resize(1);
+		slotDependents[0].clear();
+		freeSlots.clear();
+		slots.clear();
+		slots.emplace(this, 0);
+		setSlotBounds(0, bounds);
 		invalidLayout = true;
+		fullLayout = true;
 		canWrapH = false;
 		canWrapW = false;
 
 		//drawing caches
 		drawnLastFrame.clear();
+		exposed.clear();
 		needsRedraw.clear();
 		firstDraw = true;
 		updated.clear();
+
+		invalidateSpatialIndex();
 	}
 	
 	void ConstraintsContainer::addChild(const Component::Type& child)
 	{
 		children.emplace_back(child);
+		childSlots.push_back(slotOf(child.get()));
+		invalidateSpatialIndex();
 		child->setParent(*this);
 		child->poke();
 		needsRedraw.insert(child.get());
@@ -1720,7 +2968,8 @@ namespace Guider
 			return std::unique_ptr<RegularConstraintBuilder>();
 		Constraint c(Constraint::Type::Regular, orientation);
 
-		c.regular.target = target.get();
+		size_t slot = slotOf(target.get());
+		c.regular.target = slot;
 		c.constOffset = constOffset;
 
 		if (target.get() == this)
@@ -1734,40 +2983,35 @@ namespace Guider
 			c.setSecondEdge(false);
 		}
 
-		auto it = clusterMapping.find(target.get());
-
-		auto cluster = clusters.end();
+		auto cluster = slotClusters[slot];
 
-		if (it != clusterMapping.end())
+		if (cluster != clusters.end())
 		{
-			for (const auto& i : it->second->constraints)
+			for (const auto& i : cluster->constraints)
 			{
-				if (i->getOrientation() == orientation && i->isFor(*target)) //there is already constraint for that orientation
+				if (i->getOrientation() == orientation && i->isFor(slot)) //there is already constraint for that orientation
 				{
 					return std::unique_ptr<RegularConstraintBuilder>();
 				}
 			}
-			cluster = it->second;
 		}
 		else
 		{
-			clusters.emplace_back();
-			cluster = std::prev(clusters.end());
+			cluster = createCluster();
+			addComponent(cluster, slot);
 		}
 
 		if (cluster != clusters.end())
 		{
 			if (target.get() != this)
 				needsRedraw.insert(target.get());
-			cluster->components.insert(target.get());
 			constraints.emplace_back(std::move(c));
-			cluster->constraints.insert(&constraints.back());
-			clusterMapping[target.get()] = cluster;
+			cluster->constraints.push_back(&constraints.back());
+			markDirty(*cluster);
 
 			invalidLayout = true;
-			messyClusters = true;
 			invalidate();
-			return std::make_unique<RegularConstraintBuilder>(constraints.back(), cluster);
+			return std::make_unique<RegularConstraintBuilder>(*this, constraints.back(), cluster);
 		}
 
 		return std::unique_ptr<RegularConstraintBuilder>();
@@ -1789,24 +3033,56 @@ namespace Guider
 			Component* t = target.get();
 			if (t == this)
 				return std::unique_ptr<ChainConstraintBuilder>();
-			c.chain.targets.emplace_back(t, 0.f);
+			size_t slot = slotOf(t);
+			c.chain.targets.emplace_back(slot, 0.f);
 
-			auto it = clusterMapping.find(target.get());
-			if (it != clusterMapping.end())
+			auto cluster = slotClusters[slot];
+			if (cluster != clusters.end())
 			{
-				for (const auto& i : it->second->constraints)
+				for (const auto& i : cluster->constraints)
 				{
 					if (i->getType() == Constraint::Type::Chain) //there is another chain constraint on one target
 					{
 						return std::unique_ptr<ChainConstraintBuilder>();
 					}
-					else if (i->getOrientation() == orientation && i->isFor(*target)) //there is already constraint for that orientation on one target
+					else if (i->getOrientation() == orientation && i->isFor(slot)) //there is already constraint for that orientation on one target
 					{
 						return std::unique_ptr<ChainConstraintBuilder>();
 					}
 				}
-				clustersToMerge.emplace(it->second);
+				clustersToMerge.emplace(cluster);
+			}
+		}
+
+		if (!clustersToMerge.empty())
+		{
+			//merged cluster can not depend on itself, directly or through other clusters
+			uint64_t merged = ++searchMark;
+			for (const auto& cluster : clustersToMerge)
+				cluster->visited = merged;
+			uint64_t mark = ++searchMark;
+			forwardSearch.clear();
+			auto visit = [&](Cluster& cluster) {
+				if (cluster.visited == merged)
+					throw std::logic_error("ConstraintsContainer constraints form a dependency cycle");
+				if (cluster.visited != mark)
+				{
+					cluster.visited = mark;
+					forwardSearch.push_back(&cluster);
+				}
+			};
+			for (const auto& cluster : clustersToMerge)
+				forEachDependent(*cluster, visit);
+			for (const auto& target : c.chain.targets)
+			{
+				if (slotClusters[target.first] == clusters.end())
+				{
+					for (auto dependent : slotDependents[target.first])
+						visit(*dependent);
+				}
 			}
+			for (size_t i = 0; i < forwardSearch.size(); ++i)
+				forEachDependent(*forwardSearch[i], visit);
 		}
 
 		c.constOffset = constOffset;
@@ -1823,54 +3099,66 @@ namespace Guider
 
 		if (clustersToMerge.empty()) //elements are not in clusters, create new one
 		{
-			clusters.emplace_back();
-			auto cluster = std::prev(clusters.end());
+			auto cluster = createCluster();
 
 			//create cluster
+			for (const auto& target : c.chain.targets)
+				addComponent(cluster, target.first);
 			constraints.emplace_back(std::move(c));
-			cluster->constraints.insert(&constraints.back());
-			for (const auto& target : targets)
-			{
-				clusterMapping[target.get()] = cluster;
-				cluster->components.insert(target.get());
-			}
+			cluster->constraints.push_back(&constraints.back());
+			markDirty(*cluster);
 
 			invalidLayout = true;
-			messyClusters = true;
 
-			return std::make_unique<ChainConstraintBuilder>(constraints.back(), cluster);
+			return std::make_unique<ChainConstraintBuilder>(*this, constraints.back(), cluster);
 		}
 		else //move constraints to one cluster
 		{
-			clusters.emplace_back();
-			auto cluster = std::prev(clusters.end());
+			auto cluster = createCluster();
 			//steel constraints
 			for (const auto& clusterToMerge : clustersToMerge)
 			{
 				for (const auto& constraint : clusterToMerge->constraints)
 				{
-					cluster->constraints.insert(constraint);
+					cluster->constraints.push_back(constraint);
 				}
 				for (const auto& dependency : clusterToMerge->dependencies)
 				{
-					cluster->dependencies.insert(dependency);
+					cluster->dependencies[dependency.first] += dependency.second;
+					for (auto& dependent : slotDependents[dependency.first])
+					{
+						if (dependent == &(*clusterToMerge))
+							dependent = &(*cluster);
+					}
+				}
+				for (auto component : clusterToMerge->components)
+				{
+					slotClusters[component] = cluster;
+					cluster->components.push_back(component);
 				}
 				//remove unwanted clusters
-				clusters.erase(clusterToMerge);
+				eraseCluster(clusterToMerge);
 			}
 			//add new one
-			constraints.emplace_back(std::move(c));
-			cluster->constraints.insert(&constraints.back());
-			for (const auto& target : targets)
+			for (const auto& target : c.chain.targets)
 			{
-				clusterMapping[target.get()] = cluster;
-				cluster->components.insert(target.get());
+				if (slotClusters[target.first] != cluster)
+				{
+					slotClusters[target.first] = cluster;
+					cluster->components.push_back(target.first);
+				}
 			}
+			//merged cluster is last in order, clusters depending on it are moved after it
+			forEachDependent(*cluster, [this, &cluster](Cluster& dependent) {
+				orderAfter(*cluster, dependent);
+				});
+			constraints.emplace_back(std::move(c));
+			cluster->constraints.push_back(&constraints.back());
+			markDirty(*cluster);
 
 			invalidLayout = true;
-			messyClusters = true;
 
-			return std::make_unique<ChainConstraintBuilder>(constraints.back(), cluster);
+			return std::make_unique<ChainConstraintBuilder>(*this, constraints.back(), cluster);
 		}
 
 		return std::unique_ptr<ChainConstraintBuilder>();
@@ -1886,7 +3174,9 @@ namespace Guider
 		else
 		{
 			for (const auto& i : drawnLastFrame)
-				getBackend()->addToMask(i.second);
+				getBackend()->addDamagedRect(i.second);
+			for (const auto& i : exposed)
+				getBackend()->addDamagedRect(i);
 			for (auto element : needsRedraw)
 			{
 				element->drawMask(canvas);
@@ -1896,7 +3186,7 @@ namespace Guider
 	
 	void ConstraintsContainer::onDraw(Canvas& canvas)
 	{
-		if (needsRedraw.size() > 0)
+		if (!needsRedraw.empty() || !exposed.empty())
 		{
 			if (backgroundColor.a > 0 && firstDraw)
 			{
@@ -1909,72 +3199,36 @@ namespace Guider
 			}
 			else
 			{
-				std::unordered_set<Component*> forceRedraw;
-
-				std::vector<std::pair<Rect, Component*>> base;
-				std::vector<std::pair<Rect, Component*>> lastBase;
-				base.reserve(needsRedraw.size());
+				//children overlapping redrawn ones or area left by moved ones are drawn again,
+				//only children near those rects are visited
+				overlapping.clear();
 				for (auto i : needsRedraw)
 				{
-					Rect localBounds = i->getBounds();
-					base.emplace_back(localBounds, i);
+					overlapping.emplace_back(getChildKey(*i), i);
+					queryChildren(i->getBounds(), overlapping);
 				}
-
-				for (auto& i : drawnLastFrame)
+				for (const auto& i : drawnLastFrame)
 				{
-					Rect localBounds = i.second;
-					lastBase.emplace_back(localBounds, i.first);
+					overlapping.emplace_back(getChildKey(*i.first), i.first);
+					queryChildren(i.second, overlapping);
 				}
+				for (const auto& i : exposed)
+					queryChildren(i, overlapping);
+				std::sort(overlapping.begin(), overlapping.end(), [](const SpatialIndex::Item& a, const SpatialIndex::Item& b) {
+					return a.key < b.key;
+				});
+				overlapping.erase(std::unique(overlapping.begin(), overlapping.end(), [](const SpatialIndex::Item& a, const SpatialIndex::Item& b) {
+					return a.key == b.key;
+				}), overlapping.end());
 
-				for (const auto& i : children)
-				{
-					Component* p = i.get();
-					//all elements that were moved should redraw all its content internally,
-					//so we only need to worry about not updated ones
-					if (!drawnLastFrame.count(p))
-					{
-						//check if element intersects with any object moved during this frame
-						//and force redraw if it does
-						Rect localBounds = p->getBounds();
-						for (const auto& j : lastBase)
-						{
-							if (j.first.intersects(localBounds))
-							{
-								forceRedraw.insert(p);
-							}
-						}
-					}
-					//check if element intersects with any object currently being drawn
-					//and force redraw if it does
-					Rect localBounds = i->getBounds();
-					for (const auto& j : base)
-					{
-						if (j.first.intersects(localBounds))
-						{
-							forceRedraw.insert(j.second);
-							forceRedraw.insert(p);
-						}
-					}
-
-				}
 				if (backgroundColor.a > 0)
 					canvas.drawRectangle(getBounds().at(Vec2(0.f, 0.f)), backgroundColor);
-				for (const auto& i : children)
-				{
-					Rect localBounds = i->getBounds();
-					Component* c = i.get();
-					if (forceRedraw.count(c))
-					{
-						c->redraw(canvas);
-					}
-					else if (needsRedraw.count(c))
-					{
-						c->draw(canvas);
-					}
-				}
+				for (const auto& i : overlapping)
+					i.component->redraw(canvas);
 			}
 			needsRedraw.clear();
 			drawnLastFrame.clear();
+			exposed.clear();
 		}
 		else if (backgroundColor.a > 0 && firstDraw)
 		{
@@ -2002,6 +3256,7 @@ namespace Guider
 		}
 		needsRedraw.clear();
 		drawnLastFrame.clear();
+		exposed.clear();
 		firstDraw = false;
 	}
 	
@@ -2464,12 +3719,20 @@ namespace Guider
 		}
 	}
 	
-	ConstraintsContainer::ConstraintsContainer() : firstDraw(true), messyClusters(true), invalidLayout(true), canWrapW(false), canWrapH(false), backgroundColor(0)
+	ConstraintsContainer::ConstraintsContainer() : emptyOrders(0), searchMark(0), updated(DirtyList::Kind::Update), needsRedraw(DirtyList::Kind::Redraw), firstDraw(true), invalidLayout(true), fullLayout(true), canWrapW(false), canWrapH(false), backgroundColor(0)
 	{
+		useSpatialIndex();
+		slotOf(this);
 	}
 	
 	ConstraintsContainer::Iterator ConstraintsContainer::firstElement()
 	{
 		return createIterator<IteratorType>(children.begin(), children.end());
 	}
+
+	void ConstraintsContainer::visitChildren(const ChildVisitor& visitor)
+	{
+		for (const auto& c : children)
+			visitor(*c);
+	}
 }
\ No newline at end of file
@@ -0,0 +1,262 @@
+#include <guider/headless.hpp>
+
+namespace Guider
+{
+	void RecordingCanvas::drawRectangle(const Rect& rect, const Color& color)
+	{
+		record(Command::Type::DrawRectangle, rect, color);
+	}
+
+	void RecordingCanvas::record(Command::Type type, const Rect& rect, const Color& color)
+	{
+		commands.emplace_back(type, rect, color);
+	}
+
+	const std::vector<RecordingCanvas::Command>& RecordingCanvas::getCommands() const noexcept
+	{
+		return commands;
+	}
+
+	size_t RecordingCanvas::count(Command::Type type) const noexcept
+	{
+		return std::count_if(commands.begin(), commands.end(), [type](const Command& c) {
+			return c.type == type;
+		});
+	}
+
+	void RecordingCanvas::clear()
+	{
+		commands.clear();
+	}
+
+
+	namespace HeadlessResources
+	{
+		//image canvases inherit Canvas twice, so cross cast is required to reach recording part
+		static RecordingCanvas* getRecordingCanvas(Canvas& canvas)
+		{
+			return dynamic_cast<RecordingCanvas*>(&canvas.getRenderingCanvas());
+		}
+
+		void ImageResource::draw(Canvas& canvas, const Rect& bounds)
+		{
+			RecordingCanvas* c = getRecordingCanvas(canvas);
+			if (c != nullptr)
+				c->record(RecordingCanvas::Command::Type::DrawImage, bounds);
+		}
+
+		Guider::Resources::ImageResource& ImageCanvas::getImage()
+		{
+			return image;
+		}
+
+		void ImageCanvas::drawRectangle(const Rect& rect, const Color& color)
+		{
+			RecordingCanvas::drawRectangle(rect, color);
+		}
+
+		void ImageCanvas::clear()
+		{
+			RecordingCanvas::clear();
+		}
+
+		void RectangleShape::draw(Canvas& canvas, const Rect& bounds)
+		{
+			Rect rect = bounds;
+			if (size.x != 0 || size.y != 0)
+			{
+				rect.width = size.x;
+				rect.height = size.y;
+			}
+			canvas.drawRectangle(rect, color);
+		}
+
+		void RectangleShape::setSize(const Vec2& s)
+		{
+			size = s;
+		}
+
+		void RectangleShape::setColor(const Color& c)
+		{
+			color = c;
+		}
+
+		float FontResource::getLineHeight(float textSize) const
+		{
+			return textSize * lineSpacing;
+		}
+
+		float FontResource::getLineWidth(float textSize, const std::string& text) const
+		{
+			return textSize * advance * text.size();
+		}
+
+		void TextResource::draw(Canvas& canvas, const Rect& bounds)
+		{
+			RecordingCanvas* c = getRecordingCanvas(canvas);
+			if (c != nullptr)
+				c->record(RecordingCanvas::Command::Type::DrawText, getAdjustedRect(bounds), color);
+		}
+
+		void TextResource::setText(const std::string& t)
+		{
+			text = t;
+		}
+
+		void TextResource::setTextSize(float size)
+		{
+			textSize = size;
+		}
+
+		void TextResource::setFont(const Guider::Resources::FontResource& f)
+		{
+			font = &f;
+		}
+
+		void TextResource::setColor(const Color& c)
+		{
+			color = c;
+		}
+
+		float TextResource::getLineHeight() const
+		{
+			if (font != nullptr)
+				return font->getLineHeight(textSize);
+			return 0;
+		}
+
+		float TextResource::getLineWidth() const
+		{
+			if (font != nullptr)
+				return font->getLineWidth(textSize, text);
+			return 0;
+		}
+	}
+
+
+	void HeadlessBackend::setDrawOrigin(float x, float y)
+	{
+		current->record(RecordingCanvas::Command::Type::SetDrawOrigin, Rect(x, y, 0, 0));
+	}
+
+	void HeadlessBackend::clearMask()
+	{
+		canvas->record(RecordingCanvas::Command::Type::ClearMask);
+	}
+
+	void HeadlessBackend::setupMask()
+	{
+		canvas->record(RecordingCanvas::Command::Type::SetupMask);
+	}
+
+	void HeadlessBackend::useMask()
+	{
+		canvas->record(RecordingCanvas::Command::Type::UseMask);
+	}
+
+	void HeadlessBackend::disableMask()
+	{
+		canvas->record(RecordingCanvas::Command::Type::DisableMask);
+	}
+
+	void HeadlessBackend::pushMaskLayer()
+	{
+		canvas->record(RecordingCanvas::Command::Type::PushMaskLayer);
+	}
+
+	void HeadlessBackend::popMaskLayer()
+	{
+		canvas->record(RecordingCanvas::Command::Type::PopMaskLayer);
+	}
+
+	void HeadlessBackend::addToMask(const Rect& rect)
+	{
+		canvas->record(RecordingCanvas::Command::Type::AddToMask, rect);
+	}
+
+	void HeadlessBackend::useMaskRects(const std::vector<Rect>& rects)
+	{
+		for (const Rect& r : rects)
+			canvas->record(RecordingCanvas::Command::Type::UseMaskRect, r);
+	}
+
+	void HeadlessBackend::disableMaskRects()
+	{
+		canvas->record(RecordingCanvas::Command::Type::DisableMaskRects);
+	}
+
+	std::shared_ptr<Canvas> HeadlessBackend::getCanvas()
+	{
+		return std::static_pointer_cast<Canvas>(canvas);
+	}
+
+	void HeadlessBackend::setBounds(const Rect& rect)
+	{
+		current->record(RecordingCanvas::Command::Type::SetBounds, rect);
+	}
+
+	void HeadlessBackend::setLayer(Resources::ImageCanvas* layer)
+	{
+		if (layer != nullptr)
+			current = static_cast<HeadlessResources::ImageCanvas*>(layer);
+		else
+			current = canvas.get();
+	}
+
+	Vec2 HeadlessBackend::getSize() const noexcept
+	{
+		return size;
+	}
+
+	void HeadlessBackend::setSize(const Vec2& s)
+	{
+		size = s;
+	}
+
+	std::shared_ptr<Resources::RectangleShape> HeadlessBackend::createRectangle(const Vec2& s, const Color& color)
+	{
+		return std::make_shared<HeadlessResources::RectangleShape>(s, color);
+	}
+
+	std::shared_ptr<Resources::TextResource> HeadlessBackend::createText(const std::string& text, const Resources::FontResource& font, float s, const Color& color)
+	{
+		std::shared_ptr<Resources::TextResource> res = std::make_shared<HeadlessResources::TextResource>();
+		res->setText(text);
+		res->setFont(font);
+		res->setTextSize(s);
+		res->setColor(color);
+
+		return res;
+	}
+
+	std::shared_ptr<Resources::FontResource> HeadlessBackend::getFontByName(const std::string& name)
+	{
+		auto it = fonts.find(name);
+		if (it != fonts.end())
+			return it->second;
+		return defaultFont;
+	}
+
+	std::shared_ptr<Resources::FontResource> HeadlessBackend::loadFontFromFile(const std::string&, const std::string& name)
+	{
+		std::shared_ptr<HeadlessResources::FontResource> font = std::make_shared<HeadlessResources::FontResource>();
+		fonts[name] = font;
+		return font;
+	}
+
+	std::shared_ptr<Resources::ImageResource> HeadlessBackend::loadImageFromFile(const std::string&)
+	{
+		return std::make_shared<HeadlessResources::ImageResource>(0, 0);
+	}
+
+	std::shared_ptr<Resources::ImageCanvas> HeadlessBackend::createImage(const Vec2& s)
+	{
+		return std::make_shared<HeadlessResources::ImageCanvas>(static_cast<size_t>(s.x), static_cast<size_t>(s.y));
+	}
+
+	void HeadlessBackend::deleteResource(Resources::Resource&) {}
+
+	HeadlessBackend::HeadlessBackend(const Vec2& s) : Backend(), canvas(std::make_shared<RecordingCanvas>()), current(canvas.get()), defaultFont(std::make_shared<HeadlessResources::FontResource>()), size(s)
+	{
+	}
+}
\ No newline at end of file
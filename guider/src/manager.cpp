@@ -223,6 +223,14 @@ namespace Guider
 
 		c.setSize(w.first, h.first);
 		c.setSizingMode(w.second, h.second);
+
+		auto cacheP = style.getAttribute("cacheAsLayer");
+		if (cacheP)
+			c.setCacheAsLayer(cacheP->as<bool>());
+
+		auto retainedP = style.getAttribute("retained");
+		if (retainedP)
+			c.setRetained(retainedP->as<bool>());
 	}
 
 	void Manager::registerTypeCreator(const std::function<Component::Type(Manager&, const XML::Tag&, ComponentBindings&, const StylingPack&)>& f, const std::string& name)
@@ -544,6 +552,20 @@ namespace Guider
 		registerColorProperty("color");
 		registerProperty<std::pair<float, Component::SizingMode>>("width", strToMeasure);
 		registerProperty<std::pair<float, Component::SizingMode>>("height", strToMeasure);
+		registerProperty<bool>("cacheAsLayer", [](const std::string& value) {
+			bool failed = false;
+			bool cache = Styles::strToBool(value, failed);
+			if (failed)
+				throw std::invalid_argument("invalid cacheAsLayer value");
+			return cache;
+		});
+		registerProperty<bool>("retained", [](const std::string& value) {
+			bool failed = false;
+			bool retained = Styles::strToBool(value, failed);
+			if (failed)
+				throw std::invalid_argument("invalid retained value");
+			return retained;
+		});
 	}
 	std::shared_ptr<Styles::Value> Manager::createValueForProperty(const std::string& component, const std::string& name, const std::string& value)
 	{
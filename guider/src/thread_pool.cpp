@@ -0,0 +1,129 @@
+#include <guider/thread_pool.hpp>
+
+namespace Guider
+{
+	/// @brief True while thread runs task of any pool.
+	static thread_local bool runningTask = false;
+
+	void ThreadPool::run(size_t count, const Task& task)
+	{
+		if (count == 0)
+			return;
+		//nested batch would wait for workers busy with the outer one
+		if (workers.empty() || count == 1 || runningTask)
+		{
+			for (size_t i = 0; i < count; ++i)
+				task(i);
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			this->task = &task;
+			this->count = count;
+			next.store(0, std::memory_order_relaxed);
+			running = workers.size();
+			errorIndex = count;
+			error = nullptr;
+			++batch;
+		}
+		started.notify_all();
+
+		runTasks();
+
+		std::exception_ptr e;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			finished.wait(lock, [this]() { return running == 0; });
+			this->task = nullptr;
+			std::swap(e, error);
+		}
+		if (e)
+			std::rethrow_exception(e);
+	}
+
+	size_t ThreadPool::getConcurrency() const noexcept
+	{
+		return workers.size() + 1;
+	}
+
+	bool ThreadPool::isRunningTask() noexcept
+	{
+		return runningTask;
+	}
+
+	void ThreadPool::work()
+	{
+		uint64_t done = 0;
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true)
+		{
+			started.wait(lock, [this, done]() { return stopping || batch != done; });
+			if (stopping)
+				return;
+			done = batch;
+
+			lock.unlock();
+			runTasks();
+			lock.lock();
+
+			if (--running == 0)
+				finished.notify_one();
+		}
+	}
+
+	void ThreadPool::runTasks()
+	{
+		runningTask = true;
+		size_t i;
+		while ((i = next.fetch_add(1, std::memory_order_relaxed)) < count)
+		{
+			try
+			{
+				(*task)(i);
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (i < errorIndex)
+				{
+					errorIndex = i;
+					error = std::current_exception();
+				}
+			}
+		}
+		runningTask = false;
+	}
+
+	void ThreadPool::stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		started.notify_all();
+		for (auto& w : workers)
+			w.join();
+		workers.clear();
+	}
+
+	ThreadPool::ThreadPool(size_t n) : task(nullptr), count(0), next(0), running(0), batch(0), stopping(false), errorIndex(0)
+	{
+		try
+		{
+			workers.reserve(n);
+			for (size_t i = 0; i < n; ++i)
+				workers.emplace_back(&ThreadPool::work, this);
+		}
+		catch (...)
+		{
+			stop();
+			throw;
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		stop();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,85 @@
+#include <catch2/catch.hpp>
+
+#include "helpers.hpp"
+
+using namespace Guider;
+using Tests::EngineFixture;
+using Tests::CountingRectangle;
+
+namespace
+{
+	/// @brief Absolute container filling headless engine, with 10x10 grid of 30x30 boxes spaced by 40.
+	class GridFixture : public EngineFixture
+	{
+	public:
+		std::shared_ptr<AbsoluteContainer> container;
+
+		/// @brief Updates and draws single frame, measure counters are reset before updating.
+		void frame()
+		{
+			for (auto& c : counted)
+				c->measures = 0;
+			EngineFixture::frame();
+		}
+
+		/// @brief Returns indices of boxes measured in last frame.
+		std::vector<size_t> measured() const
+		{
+			std::vector<size_t> ret;
+			for (size_t i = 0; i < counted.size(); ++i)
+			{
+				if (counted[i]->measures > 0)
+					ret.push_back(i);
+			}
+			return ret;
+		}
+
+		GridFixture() : EngineFixture(Vec2(400.f, 400.f))
+		{
+			container = std::make_shared<AbsoluteContainer>();
+			container->setSizingMode(Component::SizingMode::MatchParent, Component::SizingMode::MatchParent);
+			for (size_t i = 0; i < 100; ++i)
+			{
+				counted.push_back(std::make_shared<CountingRectangle>(30.f, 30.f));
+				container->addChild(counted.back(), float(i % 10) * 40.f, float(i / 10) * 40.f);
+			}
+			engine.addChild(container);
+			frame();
+		}
+	};
+}
+
+TEST_CASE("AbsoluteContainer updates only stained children", "[AbsoluteContainer]")
+{
+	GridFixture f;
+	CHECK(f.measured() == EngineFixture::range(0, 100));
+	CHECK(f.drawn() == EngineFixture::range(0, 100));
+
+	SECTION("without changes")
+	{
+		f.frame();
+		CHECK(f.measured().empty());
+		CHECK(f.drawn().empty());
+	}
+
+	SECTION("after growing child over its neighbours")
+	{
+		f.counted[44]->setSize(60.f, 60.f);
+		f.frame();
+		CHECK(f.measured() == std::vector<size_t>{ 44 });
+		CHECK(f.drawn() == std::vector<size_t>{ 44, 45, 54, 55 });
+		CHECK(f.counted[44]->getBounds() == Rect(160.f, 160.f, 60.f, 60.f));
+		CHECK(f.counted[45]->getBounds() == Rect(200.f, 160.f, 30.f, 30.f));
+	}
+
+	SECTION("after shrinking grown child")
+	{
+		f.counted[44]->setSize(60.f, 60.f);
+		f.frame();
+		f.counted[44]->setSize(10.f, 10.f);
+		f.frame();
+		CHECK(f.measured() == std::vector<size_t>{ 44 });
+		CHECK(f.drawn() == std::vector<size_t>{ 44, 45, 54, 55 });
+		CHECK(f.counted[44]->getBounds() == Rect(160.f, 160.f, 10.f, 10.f));
+	}
+}
\ No newline at end of file
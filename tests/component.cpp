@@ -0,0 +1,83 @@
+#include <catch2/catch.hpp>
+
+#include "helpers.hpp"
+
+using namespace Guider;
+using Tests::EngineFixture;
+using Tests::CountingRectangle;
+
+namespace
+{
+	Component::DimensionDesc upTo(float value)
+	{
+		return Component::DimensionDesc(value, Component::DimensionDesc::Max);
+	}
+}
+
+TEST_CASE("Component memoizes last measurements", "[Component]")
+{
+	EngineFixture f(Vec2(400.f, 400.f));
+	auto container = std::make_shared<AbsoluteContainer>();
+	container->setSizingMode(Component::SizingMode::OwnSize, Component::SizingMode::OwnSize);
+	container->setSize(400.f, 400.f);
+	auto box = std::make_shared<CountingRectangle>(30.f, 30.f);
+	container->addChild(box);
+	f.engine.addChild(container);
+	f.frame();
+
+	box->measure(upTo(100.f), upTo(100.f));
+	box->measures = 0;
+	Component::resetMeasureCacheStats();
+
+	SECTION("same suggestion is answered from cache")
+	{
+		auto m = box->measure(upTo(100.f), upTo(100.f));
+		CHECK(box->measures == 0);
+		CHECK(m.first.value == 30.f);
+		CHECK(Component::getMeasureCacheHits() == 1);
+		CHECK(Component::getMeasureCacheMisses() == 0);
+	}
+
+	SECTION("four suggestions are kept, oldest is evicted")
+	{
+		for (float v : { 101.f, 102.f, 103.f })
+			box->measure(upTo(v), upTo(v));
+		CHECK(box->measures == 3);
+		box->measure(upTo(100.f), upTo(100.f));
+		CHECK(box->measures == 3);
+
+		box->measure(upTo(104.f), upTo(104.f));
+		CHECK(box->measures == 4);
+		box->measure(upTo(100.f), upTo(100.f));
+		CHECK(box->measures == 5);
+		CHECK(Component::getMeasureCacheMisses() == 5);
+	}
+
+	SECTION("suggestion of different mode is measured")
+	{
+		box->measure(Component::DimensionDesc(100.f, Component::DimensionDesc::Exact), upTo(100.f));
+		CHECK(box->measures == 1);
+	}
+
+	SECTION("parent size change is measured again")
+	{
+		//resized parent measures box with new suggestions, without invalidating it
+		container->setSize(300.f, 400.f);
+		f.frame();
+		CHECK(box->measures == 1);
+		CHECK(container->getBounds().width == 300.f);
+
+		box->measure(upTo(100.f), upTo(100.f));
+		CHECK(box->measures == 2);
+		box->measure(upTo(100.f), upTo(100.f));
+		CHECK(box->measures == 2);
+	}
+
+	SECTION("invalidation clears cache")
+	{
+		box->setSize(50.f, 50.f);
+		auto m = box->measure(upTo(100.f), upTo(100.f));
+		CHECK(box->measures == 1);
+		CHECK(m.first.value == 50.f);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,166 @@
+#include <catch2/catch.hpp>
+
+#include "helpers.hpp"
+
+#include <random>
+
+using namespace Guider;
+using Tests::ConstraintsFixture;
+
+namespace
+{
+	/// @brief Adds boxes attached to container or random earlier boxes, same seed gives same layout.
+	void addRandomBoxes(ConstraintsFixture& f, size_t count, unsigned seed)
+	{
+		std::mt19937 rng(seed);
+		for (size_t i = 0; i < count; ++i)
+		{
+			size_t left = i == 0 || rng() % 3 == 0 ? ConstraintsFixture::container : rng() % i;
+			size_t top = i == 0 || rng() % 3 == 0 ? ConstraintsFixture::container : rng() % i;
+			f.addBox(float(5 + rng() % 60), float(5 + rng() % 60), left, top, float(rng() % 10));
+		}
+	}
+
+	/// @brief Resizes random boxes of every fixture the same way.
+	void resizeRandomBoxes(const std::vector<ConstraintsFixture*>& fixtures, size_t count, std::mt19937& rng)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			size_t box = rng() % fixtures.front()->boxes.size();
+			float width = float(5 + rng() % 60), height = float(5 + rng() % 60);
+			for (auto f : fixtures)
+				f->boxes[box]->setSize(width, height);
+		}
+	}
+}
+
+TEST_CASE("ConstraintsContainer solved by ThreadPool matches serial layout", "[ConstraintsContainer]")
+{
+	auto pool = std::make_shared<ThreadPool>(3);
+	ConstraintsFixture serial(Vec2(3000.f, 3000.f)), parallel(Vec2(3000.f, 3000.f), pool);
+	addRandomBoxes(serial, 300, 11);
+	addRandomBoxes(parallel, 300, 11);
+	serial.frame();
+	parallel.frame();
+	CHECK(serial.bounds() == parallel.bounds());
+
+	std::mt19937 rng(7);
+	SECTION("after resizing few boxes")
+	{
+		for (int round = 0; round < 10; ++round)
+		{
+			resizeRandomBoxes({ &serial, &parallel }, 3, rng);
+			serial.frame();
+			parallel.frame();
+			CHECK(serial.bounds() == parallel.bounds());
+		}
+	}
+
+	SECTION("after resizing many boxes")
+	{
+		for (int round = 0; round < 10; ++round)
+		{
+			resizeRandomBoxes({ &serial, &parallel }, 150, rng);
+			serial.frame();
+			parallel.frame();
+			CHECK(serial.bounds() == parallel.bounds());
+		}
+	}
+
+	SECTION("after resizing engine")
+	{
+		serial.engine.resize(Vec2(2000.f, 2500.f));
+		parallel.engine.resize(Vec2(2000.f, 2500.f));
+		serial.frame();
+		parallel.frame();
+		CHECK(serial.bounds() == parallel.bounds());
+	}
+}
+
+TEST_CASE("ConstraintsContainer re-solving dirty clusters matches full layout", "[ConstraintsContainer]")
+{
+	ConstraintsFixture f(Vec2(3000.f, 3000.f));
+	addRandomBoxes(f, 300, 5);
+	f.frame();
+
+	SECTION("after resizing box nothing depends on")
+	{
+		for (auto& b : f.boxes)
+			b->measures = 0;
+		f.boxes.back()->setSize(70.f, 70.f);
+		f.frame();
+		size_t measured = 0;
+		for (auto& b : f.boxes)
+			measured += b->measures > 0;
+		CHECK(measured == 1);
+		CHECK(f.boxes.back()->measures > 0);
+		CHECK(f.boxes.back()->getBounds().width == 70.f);
+	}
+
+	SECTION("after resizing random boxes")
+	{
+		std::mt19937 rng(3);
+		for (int round = 0; round < 10; ++round)
+		{
+			resizeRandomBoxes({ &f }, 5, rng);
+			f.frame();
+		}
+
+		//same tree built with final sizes is solved as a whole
+		ConstraintsFixture full(Vec2(3000.f, 3000.f));
+		addRandomBoxes(full, 300, 5);
+		for (size_t i = 0; i < f.boxes.size(); ++i)
+			full.boxes[i]->setSize(f.boxes[i]->getBounds().width, f.boxes[i]->getBounds().height);
+		full.frame();
+		CHECK(f.bounds() == full.bounds());
+	}
+}
+
+TEST_CASE("ConstraintsContainer rejects constraints forming dependency cycle", "[ConstraintsContainer]")
+{
+	ConstraintsFixture f(Vec2(400.f, 400.f));
+	for (int i = 0; i < 3; ++i)
+	{
+		f.boxes.push_back(std::make_shared<Tests::CountingRectangle>(30.f, 30.f));
+		f.root->addChild(f.boxes.back());
+	}
+	auto& a = f.boxes[0];
+	auto& b = f.boxes[1];
+	auto& c = f.boxes[2];
+	auto ha = f.root->addConstraint(Orientation::Horizontal, a, false);
+	auto hb = f.root->addConstraint(Orientation::Horizontal, b, false);
+	auto hc = f.root->addConstraint(Orientation::Horizontal, c, false);
+	ha->attachLeftTo(f.root, true, 10.f);
+	hb->attachLeftTo(a, false, 10.f);
+	hc->attachLeftTo(b, false, 10.f);
+	for (auto h : { ha.get(), hb.get(), hc.get() })
+	{
+		h->attachRightTo(f.root, false, 0.f);
+		h->setSize(100.f);
+		h->setFlow(0.f);
+	}
+	f.frame();
+	CHECK(c->getBounds().left == 90.f);
+
+	SECTION("between two clusters")
+	{
+		CHECK_THROWS_WITH(ha->attachLeftTo(b, false, 0.f), "ConstraintsContainer constraints form a dependency cycle");
+	}
+
+	SECTION("through cluster in between")
+	{
+		CHECK_THROWS_WITH(ha->attachLeftTo(c, false, 0.f), "ConstraintsContainer constraints form a dependency cycle");
+	}
+
+	//rejected attachment does not change layout
+	f.root->invalidate();
+	f.frame();
+	CHECK(a->getBounds().left == 10.f);
+	CHECK(b->getBounds().left == 50.f);
+	CHECK(c->getBounds().left == 90.f);
+
+	ha->attachLeftTo(f.root, true, 20.f);
+	f.root->invalidate();
+	f.frame();
+	CHECK(c->getBounds().left == 100.f);
+}
\ No newline at end of file
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <guider/headless.hpp>
+#include <guider/containers.hpp>
+#include <guider/components.hpp>
+#include <guider/thread_pool.hpp>
+
+#include <vector>
+#include <limits>
+
+namespace Tests
+{
+	/// @brief Rectangle counting how many times it was drawn and measured.
+	class CountingRectangle : public Guider::RectangleShapeComponent
+	{
+	public:
+		size_t draws = 0;
+		size_t measures = 0;
+
+		virtual void onDraw(Guider::Canvas& canvas) override
+		{
+			++draws;
+			RectangleShapeComponent::onDraw(canvas);
+		}
+
+		virtual std::pair<Guider::Component::DimensionDesc, Guider::Component::DimensionDesc> onMeasure(const Guider::Component::DimensionDesc& w, const Guider::Component::DimensionDesc& h) override
+		{
+			++measures;
+			return RectangleShapeComponent::onMeasure(w, h);
+		}
+
+		CountingRectangle(float width, float height) : RectangleShapeComponent(width, height, Guider::Color::Black) {}
+	};
+
+	/// @brief Headless engine with counted components.
+	class EngineFixture
+	{
+	public:
+		Guider::HeadlessBackend backend;
+		Guider::Engine engine;
+		std::vector<std::shared_ptr<CountingRectangle>> counted;
+
+		/// @brief Updates and draws single frame, draw counters are reset before drawing.
+		void frame()
+		{
+			engine.update();
+			for (auto& c : counted)
+				c->draws = 0;
+			backend.getRecordingCanvas().clear();
+			engine.draw();
+		}
+
+		/// @brief Returns indices of counted components drawn in last frame.
+		std::vector<size_t> drawn() const
+		{
+			std::vector<size_t> ret;
+			for (size_t i = 0; i < counted.size(); ++i)
+			{
+				if (counted[i]->draws > 0)
+					ret.push_back(i);
+			}
+			return ret;
+		}
+
+		/// @brief Returns indices from begin to end, end excluded.
+		static std::vector<size_t> range(size_t begin, size_t end)
+		{
+			std::vector<size_t> ret;
+			for (size_t i = begin; i < end; ++i)
+				ret.push_back(i);
+			return ret;
+		}
+
+		EngineFixture(const Guider::Vec2& size) : backend(size), engine(backend)
+		{
+			engine.resize(size);
+		}
+	};
+
+	/// @brief Vertical list of equally tall rows filling headless engine.
+	class ListFixture : public EngineFixture
+	{
+	public:
+		std::shared_ptr<Guider::ListContainer> list;
+		std::vector<std::shared_ptr<CountingRectangle>>& rows;
+
+		/// @param estimatedSize if not 0, sizes of rows are estimated, see ListContainer::setSizeEstimation.
+		ListFixture(size_t count, float rowHeight, const Guider::Vec2& size, float estimatedSize = 0.f) : EngineFixture(size), rows(counted)
+		{
+			list = std::make_shared<Guider::ListContainer>();
+			list->setSizingMode(Guider::Component::SizingMode::MatchParent, Guider::Component::SizingMode::MatchParent);
+			list->setOrientation(Guider::Orientation::Vertical);
+			if (estimatedSize != 0.f)
+				list->setSizeEstimation(true, estimatedSize);
+			for (size_t i = 0; i < count; ++i)
+			{
+				rows.push_back(std::make_shared<CountingRectangle>(100.f, rowHeight));
+				list->addChild(rows.back());
+			}
+			engine.addChild(list);
+			frame();
+		}
+	};
+
+	/// @brief Constraints container filling headless engine, boxes are placed by attaching them to container or earlier boxes.
+	class ConstraintsFixture : public EngineFixture
+	{
+	public:
+		static constexpr size_t container = std::numeric_limits<size_t>::max();
+
+		std::shared_ptr<Guider::ConstraintsContainer> root;
+		std::vector<std::shared_ptr<CountingRectangle>>& boxes;
+
+		/// @brief Adds box placed right of box at index left and below box at index top, container attaches it to container start.
+		/// @return Returns index of added box.
+		size_t addBox(float width, float height, size_t left, size_t top, float offset = 0.f)
+		{
+			boxes.push_back(std::make_shared<CountingRectangle>(width, height));
+			root->addChild(boxes.back());
+			auto h = root->addConstraint(Guider::Orientation::Horizontal, boxes.back(), false);
+			h->attachLeftTo(target(left), left == container, offset);
+			h->attachRightTo(root, false, 0.f);
+			h->setSize(100.f);
+			h->setFlow(0.f);
+			auto v = root->addConstraint(Guider::Orientation::Vertical, boxes.back(), false);
+			v->attachTopTo(target(top), top == container, offset);
+			v->attachBottomTo(root, false, 0.f);
+			v->setSize(100.f);
+			v->setFlow(0.f);
+			return boxes.size() - 1;
+		}
+
+		/// @brief Returns bounds of all boxes.
+		std::vector<Guider::Rect> bounds() const
+		{
+			std::vector<Guider::Rect> ret;
+			for (auto& b : boxes)
+				ret.push_back(b->getBounds());
+			return ret;
+		}
+
+		ConstraintsFixture(const Guider::Vec2& size, const std::shared_ptr<Guider::ThreadPool>& pool = nullptr) : EngineFixture(size), boxes(counted)
+		{
+			root = std::make_shared<Guider::ConstraintsContainer>();
+			root->setSizingMode(Guider::Component::SizingMode::MatchParent, Guider::Component::SizingMode::MatchParent);
+			root->setThreadPool(pool);
+			engine.addChild(root);
+		}
+	private:
+		Guider::Component::Type target(size_t index) const
+		{
+			if (index == container)
+				return root;
+			return boxes[index];
+		}
+	};
+}
\ No newline at end of file
@@ -0,0 +1,189 @@
+#include <catch2/catch.hpp>
+
+#include "helpers.hpp"
+
+using namespace Guider;
+using Tests::ListFixture;
+
+TEST_CASE("ListContainer draws only rows in viewport", "[ListContainer]")
+{
+	ListFixture f(100, 20.f, Vec2(200.f, 400.f));
+
+	SECTION("after setting offset")
+	{
+		f.list->setOffset(-210.f);
+		f.frame();
+		CHECK(f.drawn() == ListFixture::range(10, 31));
+		CHECK(f.rows[10]->getBounds().top == -10.f);
+		CHECK(f.rows[30]->getBounds().top == 390.f);
+	}
+
+	SECTION("after offset past the end")
+	{
+		f.list->setOffset(-1990.f);
+		f.frame();
+		CHECK(f.drawn() == ListFixture::range(99, 100));
+		CHECK(f.rows[99]->getBounds().top == -10.f);
+	}
+}
+
+TEST_CASE("ListContainer rows enter and leave viewport when scrolled", "[ListContainer]")
+{
+	ListFixture f(100, 20.f, Vec2(200.f, 400.f));
+	f.list->setOffset(-210.f);
+	f.frame();
+
+	SECTION("scrolling forward")
+	{
+		f.list->setOffset(-270.f);
+		f.frame();
+		CHECK(f.drawn() == ListFixture::range(13, 34));
+		CHECK(f.rows[13]->getBounds().top == -10.f);
+		CHECK(f.rows[33]->getBounds().top == 390.f);
+	}
+
+	SECTION("scrolling back")
+	{
+		f.list->setOffset(-150.f);
+		f.frame();
+		CHECK(f.drawn() == ListFixture::range(7, 28));
+		CHECK(f.rows[7]->getBounds().top == -10.f);
+		CHECK(f.rows[27]->getBounds().top == 390.f);
+	}
+
+	SECTION("row resized inside viewport pushes rows out")
+	{
+		f.rows[15]->setHeight(60.f);
+		f.frame();
+		CHECK(f.rows[16]->getBounds().top == 150.f);
+		CHECK(f.rows[28]->getBounds().top == 390.f);
+		CHECK(f.rows[28]->draws == 1);
+		CHECK(f.rows[29]->draws == 0);
+	}
+}
+
+TEST_CASE("ListContainer removes children inside and outside viewport", "[ListContainer]")
+{
+	ListFixture f(100, 20.f, Vec2(200.f, 400.f));
+	f.list->setOffset(-210.f);
+	f.frame();
+
+	SECTION("inside viewport")
+	{
+		f.list->removeChild(f.rows[15]);
+		f.frame();
+		CHECK(f.list->getChildrenCount() == 99);
+		CHECK(f.rows[14]->getBounds().top == 70.f);
+		CHECK(f.rows[16]->getBounds().top == 90.f);
+		CHECK(f.rows[31]->getBounds().top == 390.f);
+		CHECK(f.rows[31]->draws == 1);
+		CHECK(f.rows[15]->draws == 0);
+	}
+
+	SECTION("before viewport")
+	{
+		f.list->removeChild(f.rows[2]);
+		f.frame();
+		CHECK(f.list->getChildrenCount() == 99);
+		CHECK(f.rows[11]->getBounds().top == -10.f);
+		CHECK(f.rows[31]->getBounds().top == 390.f);
+		CHECK(f.rows[31]->draws == 1);
+		CHECK(f.rows[10]->draws == 0);
+	}
+
+	SECTION("after viewport")
+	{
+		f.list->removeChild(f.rows[50]);
+		f.frame();
+		CHECK(f.list->getChildrenCount() == 99);
+		CHECK(f.drawn() == ListFixture::range(10, 31));
+		CHECK(f.rows[10]->getBounds().top == -10.f);
+		CHECK(f.rows[30]->getBounds().top == 390.f);
+	}
+
+	SECTION("by index")
+	{
+		f.list->removeChild(10u);
+		f.frame();
+		CHECK(f.list->getChild(10) == f.rows[11]);
+		CHECK(f.rows[11]->getBounds().top == -10.f);
+		CHECK(f.rows[31]->draws == 1);
+	}
+}
+
+TEST_CASE("ListContainer scrolled by copy draws only exposed rows", "[ListContainer]")
+{
+	ListFixture f(100, 20.f, Vec2(200.f, 400.f));
+
+	SECTION("with scrolling by copy")
+	{
+		f.list->setScrollByCopy(true);
+		f.list->setOffset(-10.f);
+		f.frame();
+
+		f.list->setOffset(-70.f);
+		f.frame();
+		CHECK(f.drawn() == ListFixture::range(20, 24));
+		CHECK(f.rows[3]->getBounds().top == -10.f);
+		CHECK(f.rows[23]->getBounds().top == 390.f);
+
+		f.list->setOffset(-130.f);
+		f.frame();
+		CHECK(f.drawn() == ListFixture::range(23, 27));
+		CHECK(f.rows[6]->getBounds().top == -10.f);
+
+		f.list->setOffset(-70.f);
+		f.frame();
+		CHECK(f.drawn() == ListFixture::range(3, 7));
+	}
+
+	SECTION("without scrolling by copy")
+	{
+		f.list->setOffset(-10.f);
+		f.frame();
+
+		f.list->setOffset(-70.f);
+		f.frame();
+		CHECK(f.drawn() == ListFixture::range(3, 24));
+	}
+}
+
+TEST_CASE("ListContainer with size estimation corrects offsets of measured rows", "[ListContainer]")
+{
+	ListFixture f(1000, 20.f, Vec2(200.f, 400.f), 10.f);
+	CHECK(f.drawn() == ListFixture::range(0, 21));
+	CHECK(f.rows[20]->getBounds().top == 400.f);
+
+	f.list->setOffset(-5000.f);
+	f.frame();
+	auto drawn = f.drawn();
+	REQUIRE(drawn.size() == 21);
+	//rows before viewport are mostly estimated smaller than they are
+	CHECK(drawn.front() > 250);
+	CHECK(drawn == ListFixture::range(drawn.front(), drawn.front() + 21));
+	CHECK(f.rows[drawn.front()]->getBounds().top == 0.f);
+	CHECK(f.rows[drawn.back()]->getBounds().top == 400.f);
+
+	SECTION("scrolling back to measured rows")
+	{
+		f.list->setOffset(-210.f);
+		f.frame();
+		CHECK(f.drawn() == ListFixture::range(10, 31));
+		CHECK(f.rows[10]->getBounds().top == -10.f);
+		CHECK(f.rows[30]->getBounds().top == 390.f);
+	}
+
+	SECTION("row resized outside viewport")
+	{
+		//resized row is estimated again, until it comes near viewport
+		f.rows[5]->setHeight(60.f);
+		f.frame();
+		CHECK(f.rows[drawn.front()]->getBounds().top == -10.f);
+
+		f.list->setOffset(-210.f);
+		f.frame();
+		CHECK(f.drawn() == ListFixture::range(8, 29));
+		CHECK(f.rows[8]->getBounds().top == -10.f);
+		CHECK(f.rows[28]->getBounds().top == 390.f);
+	}
+}
\ No newline at end of file
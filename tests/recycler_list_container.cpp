@@ -0,0 +1,122 @@
+#include <catch2/catch.hpp>
+
+#include "helpers.hpp"
+
+using namespace Guider;
+using Tests::EngineFixture;
+using Tests::CountingRectangle;
+
+namespace
+{
+	/// @brief Adapter of equally tall rows, counting created views and remembering bound items.
+	class RowAdapter : public ListAdapter
+	{
+	public:
+		size_t count;
+		size_t created = 0;
+		std::vector<size_t> bound;
+
+		virtual size_t getItemCount() const override
+		{
+			return count;
+		}
+
+		virtual Component::Type createView() override
+		{
+			++created;
+			return std::make_shared<CountingRectangle>(100.f, 20.f);
+		}
+
+		virtual void bindView(Component&, size_t index) override
+		{
+			bound.push_back(index);
+		}
+
+		RowAdapter(size_t count) : count(count) {}
+	};
+
+	/// @brief Recycler list filling headless engine.
+	class RecyclerFixture : public EngineFixture
+	{
+	public:
+		std::shared_ptr<RowAdapter> adapter;
+		std::shared_ptr<RecyclerListContainer> list;
+
+		RecyclerFixture(size_t count, const Vec2& size) : EngineFixture(size)
+		{
+			adapter = std::make_shared<RowAdapter>(count);
+			list = std::make_shared<RecyclerListContainer>();
+			list->setSizingMode(Component::SizingMode::MatchParent, Component::SizingMode::MatchParent);
+			list->setAdapter(adapter);
+			engine.addChild(list);
+			frame();
+		}
+	};
+}
+
+TEST_CASE("RecyclerListContainer binds only visible items", "[RecyclerListContainer]")
+{
+	RecyclerFixture f(1000, Vec2(200.f, 400.f));
+	CHECK(f.list->getVisibleRange() == std::make_pair<size_t, size_t>(0, 21));
+	CHECK(f.adapter->created == 21);
+	CHECK(f.list->getItemView(20)->getBounds().top == 400.f);
+	CHECK(f.list->getItemView(21) == nullptr);
+
+	SECTION("views leaving viewport are rebound to entering items")
+	{
+		Component* leaving = f.list->getItemView(3).get();
+		f.adapter->bound.clear();
+		f.list->setOffset(-210.f);
+		f.frame();
+		CHECK(f.list->getVisibleRange() == std::make_pair<size_t, size_t>(10, 31));
+		CHECK(f.adapter->created == 21);
+		CHECK(f.adapter->bound == EngineFixture::range(21, 31));
+		CHECK(f.list->getItemView(3) == nullptr);
+		CHECK(f.list->getItemView(10)->getBounds().top == -10.f);
+		CHECK(f.list->getItemView(30)->getBounds().top == 390.f);
+
+		bool reused = false;
+		for (size_t i = 21; i < 31; ++i)
+			reused |= f.list->getItemView(i).get() == leaving;
+		CHECK(reused);
+	}
+
+	SECTION("jump far away reuses every view")
+	{
+		f.list->setOffset(-10010.f);
+		f.frame();
+		CHECK(f.list->getVisibleRange() == std::make_pair<size_t, size_t>(500, 521));
+		CHECK(f.adapter->created == 21);
+		CHECK(f.list->getItemView(500)->getBounds().top == -10.f);
+	}
+}
+
+TEST_CASE("RecyclerListContainer keeps at most pool size of unused views", "[RecyclerListContainer]")
+{
+	RecyclerFixture f(1000, Vec2(200.f, 400.f));
+	CHECK(f.list->getPoolSize() == 8);
+
+	SECTION("default pool")
+	{
+		f.engine.resize(Vec2(200.f, 100.f));
+		f.frame();
+		CHECK(f.list->getVisibleRange() == std::make_pair<size_t, size_t>(0, 6));
+
+		//15 views left viewport, only 8 of them were kept
+		f.engine.resize(Vec2(200.f, 400.f));
+		f.frame();
+		CHECK(f.list->getVisibleRange() == std::make_pair<size_t, size_t>(0, 21));
+		CHECK(f.adapter->created == 28);
+	}
+
+	SECTION("larger pool")
+	{
+		f.list->setPoolSize(20);
+		f.engine.resize(Vec2(200.f, 100.f));
+		f.frame();
+		f.engine.resize(Vec2(200.f, 400.f));
+		f.frame();
+		CHECK(f.list->getVisibleRange() == std::make_pair<size_t, size_t>(0, 21));
+		CHECK(f.adapter->created == 21);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include <catch2/catch.hpp>
+
+#include <guider/base.hpp>
+
+#include <random>
+
+using namespace Guider;
+
+namespace
+{
+	constexpr int gridSize = 32;
+
+	/// @brief Region of random rects with integer edges, also marked in grid of unit cells.
+	Region randomRegion(std::mt19937& rng, std::vector<bool>& grid, bool united)
+	{
+		std::uniform_int_distribution<int> position(0, 20), size(0, 8);
+		std::vector<Rect> rects;
+		grid.assign(gridSize * gridSize, false);
+		int count = 1 + rng() % 5;
+		for (int i = 0; i < count; ++i)
+		{
+			int x = position(rng), y = position(rng), w = size(rng), h = size(rng);
+			rects.emplace_back(float(x), float(y), float(w), float(h));
+			for (int a = x; a < x + w; ++a)
+				for (int b = y; b < y + h; ++b)
+					grid[a * gridSize + b] = true;
+		}
+		if (!united)
+			return Region(rects);
+		Region ret;
+		for (const auto& r : rects)
+			ret.unite(r);
+		return ret;
+	}
+}
+
+TEST_CASE("Region keeps canonical band form", "[Region]")
+{
+	SECTION("touching rects merge into one")
+	{
+		Region r(Rect(0.f, 0.f, 10.f, 10.f));
+		r.unite(Rect(10.f, 0.f, 10.f, 10.f));
+		r.unite(Rect(0.f, 10.f, 20.f, 5.f));
+		CHECK(r.getRects() == std::vector<Rect>{ Rect(0.f, 0.f, 20.f, 15.f) });
+	}
+
+	SECTION("rects are ordered top to bottom, left to right")
+	{
+		Region r(Rect(20.f, 10.f, 5.f, 5.f));
+		r.unite(Rect(0.f, 10.f, 5.f, 5.f));
+		r.unite(Rect(0.f, 0.f, 30.f, 5.f));
+		CHECK(r.getRects() == std::vector<Rect>{ Rect(0.f, 0.f, 30.f, 5.f), Rect(0.f, 10.f, 5.f, 5.f), Rect(20.f, 10.f, 5.f, 5.f) });
+	}
+
+	SECTION("hole splits band")
+	{
+		Region r(Rect(0.f, 0.f, 30.f, 30.f));
+		r.subtract(Rect(10.f, 10.f, 10.f, 10.f));
+		CHECK(r.getRects() == std::vector<Rect>{ Rect(0.f, 0.f, 30.f, 10.f), Rect(0.f, 10.f, 10.f, 10.f), Rect(20.f, 10.f, 10.f, 10.f), Rect(0.f, 20.f, 30.f, 10.f) });
+		CHECK(r.getBounds() == Rect(0.f, 0.f, 30.f, 30.f));
+
+		r.unite(Rect(10.f, 10.f, 10.f, 10.f));
+		CHECK(r == Region(Rect(0.f, 0.f, 30.f, 30.f)));
+	}
+
+	SECTION("same area built in different order")
+	{
+		Region a(std::vector<Rect>{ Rect(0.f, 0.f, 10.f, 20.f), Rect(5.f, 5.f, 20.f, 5.f) });
+		Region b(Rect(5.f, 5.f, 20.f, 5.f));
+		b.unite(Rect(0.f, 0.f, 10.f, 20.f));
+		CHECK(a == b);
+		CHECK(a.getRectCount() == 3);
+	}
+
+	SECTION("empty results")
+	{
+		Region r(Rect(0.f, 0.f, 10.f, 10.f));
+		r.intersect(Rect(10.f, 0.f, 10.f, 10.f));
+		CHECK(r.isEmpty());
+		CHECK(r == Region());
+		CHECK(Region(Rect(0.f, 0.f, 10.f, 10.f)).subtract(Rect(-5.f, -5.f, 20.f, 20.f)).isEmpty());
+	}
+}
+
+TEST_CASE("Region operations match brute force grid", "[Region]")
+{
+	std::mt19937 rng(1);
+	std::vector<bool> a, b;
+	int fails = 0, nonCanonical = 0;
+	for (int t = 0; t < 600; ++t)
+	{
+		Region ra = randomRegion(rng, a, t % 2 == 0);
+		Region rb = randomRegion(rng, b, t % 2 == 0);
+		int op = t % 3;
+		Region r = ra;
+		if (op == 0)
+			r.unite(rb);
+		else if (op == 1)
+			r.intersect(rb);
+		else
+			r.subtract(rb);
+
+		for (int x = 0; x < gridSize; ++x)
+		{
+			for (int y = 0; y < gridSize; ++y)
+			{
+				size_t i = x * gridSize + y;
+				bool expected = op == 0 ? a[i] || b[i] : op == 1 ? a[i] && b[i] : a[i] && !b[i];
+				if (r.contains(Vec2(x + 0.5f, y + 0.5f)) != expected)
+					++fails;
+			}
+		}
+
+		//canonical form does not depend on how area was built
+		if (Region(r.getRects()) != r)
+			++nonCanonical;
+	}
+	CHECK(fails == 0);
+	CHECK(nonCanonical == 0);
+}
\ No newline at end of file
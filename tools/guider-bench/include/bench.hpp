@@ -0,0 +1,97 @@
+#pragma once
+
+#include <guider/headless.hpp>
+#include <guider/manager.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Bench
+{
+	/// @brief Benchmark run configuration.
+	class Options
+	{
+	public:
+		/// @brief Row counts used by list scenarios.
+		std::vector<size_t> rows = { 10000 };
+		/// @brief Row count used by scroll scenario.
+		size_t scrollRows = 100000;
+		/// @brief Item count used by recycler scenario.
+		size_t recyclerItems = 1000000;
+		/// @brief Marker count used by absolute scenario.
+		size_t markers = 500;
+		/// @brief Nesting depth used by deep scenario.
+		size_t depth = 100;
+		/// @brief Number of chained constraints used by constraints scenario.
+		size_t constraints = 2000;
+		/// @brief Number of widgets used by dashboard scenario.
+		size_t widgets = 400;
+		/// @brief Threads solving layout in parallel operations, including the calling one, parallel operations are skipped if below 2.
+		size_t threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+		/// @brief Fixed number of iterations, when 0 iterations are repeated until @ref minTime passes.
+		size_t iterations = 0;
+		/// @brief Minimal measured time of single operation, in milliseconds.
+		double minTime = 200;
+		/// @brief Only benchmarks which name contains this string are run.
+		std::string filter;
+		/// @brief Path of JSON report, "-" writes to standard output.
+		std::string jsonPath;
+	};
+
+	/// @brief Single measurement.
+	class Result
+	{
+	public:
+		std::string scenario;
+		std::string operation;
+		/// @brief Number of components in measured tree.
+		size_t size;
+		size_t iterations;
+		double nsPerOp;
+	};
+
+	/// @brief Headless gui instance that scenarios build their trees in.
+	class Fixture
+	{
+	public:
+		Guider::HeadlessBackend backend;
+		Guider::Manager manager;
+		Guider::Engine engine;
+
+		/// @brief Updates and draws single frame, recorded commands are discarded.
+		void frame();
+
+		Fixture(const Guider::Vec2& size);
+	};
+
+	/// @brief Measures operations and collects results.
+	class Runner
+	{
+	public:
+		/// @brief Returns true if benchmark should be run, according to the filter.
+		bool enabled(const std::string& scenario, const std::string& operation) const;
+
+		/// @brief Measures operation.
+		/// @param prepare Called before every iteration, not included in measured time.
+		/// @param op Measured operation.
+		void measure(const std::string& scenario, const std::string& operation, size_t size,
+			const std::function<void()>& prepare, const std::function<void()>& op);
+
+		const std::vector<Result>& getResults() const noexcept;
+
+		/// @brief Returns stream of human readable progress, standard error if JSON report goes to standard output.
+		std::ostream& log() const noexcept;
+
+		/// @brief Writes results as JSON.
+		void writeJson(std::ostream& out) const;
+
+		Runner(const Options& options);
+	private:
+		const Options& options;
+		std::vector<Result> results;
+	};
+}
\ No newline at end of file
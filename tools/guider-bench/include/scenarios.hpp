@@ -0,0 +1,33 @@
+#pragma once
+
+#include <bench.hpp>
+
+namespace Bench
+{
+	/// @brief Nested constraints containers, each one inset by single pixel.
+	void runDeepScenario(Runner& runner, const Options& options);
+
+	/// @brief Vertical list with given number of rows.
+	void runListScenario(Runner& runner, const Options& options, size_t rows);
+
+	/// @brief Long list scrolled by a few rows at a time, with and without scrolling by copy.
+	void runScrollScenario(Runner& runner, const Options& options);
+
+	/// @brief Long wrap content list of text rows with estimated sizes.
+	void runEstimatedListScenario(Runner& runner, const Options& options);
+
+	/// @brief Adapter backed list, scrolled like the scroll scenario.
+	void runRecyclerScenario(Runner& runner, const Options& options);
+
+	/// @brief Overlay of absolutely positioned markers, one of them changing at a time.
+	void runAbsoluteScenario(Runner& runner, const Options& options);
+
+	/// @brief Row of elements, each constrained to the previous one.
+	void runConstraintsScenario(Runner& runner, const Options& options);
+
+	/// @brief Grid of independent widgets, laid out serially and by thread pool.
+	void runDashboardScenario(Runner& runner, const Options& options);
+
+	/// @brief Runs every scenario.
+	void runAll(Runner& runner, const Options& options);
+}
\ No newline at end of file
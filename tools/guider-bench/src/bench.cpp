@@ -0,0 +1,127 @@
+#include <bench.hpp>
+
+#include <guider/containers.hpp>
+#include <guider/components.hpp>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+namespace Bench
+{
+	void Fixture::frame()
+	{
+		engine.update();
+		engine.draw();
+		backend.getRecordingCanvas().clear();
+	}
+
+	Fixture::Fixture(const Guider::Vec2& size) : backend(size), manager(backend), engine(backend)
+	{
+		manager.registerTypeCreator([](Guider::Manager& m, const Guider::XML::Tag& config, Guider::ComponentBindings& bindings, const Guider::StylingPack& style)
+			{
+				std::shared_ptr<Guider::ConstraintsContainer> ret = std::make_shared<Guider::ConstraintsContainer>();
+				ret->postXmlConstruction(m, config, style);
+				Guider::XML::Value tmp = config.getAttribute("id");
+				if (tmp.exists())
+				{
+					bindings.registerElement(tmp.val, std::static_pointer_cast<Guider::Component>(ret));
+				}
+				return ret;
+			}, "containers.ConstraintsContainer");
+		manager.registerTypeProperties<Guider::ConstraintsContainer>("containers.ConstraintsContainer");
+		manager.registerType<Guider::ListContainer>("containers.ListContainer");
+		manager.registerType<Guider::RectangleShapeComponent>("shapes.Rectangle");
+		manager.registerType<Guider::EmptyComponent>("common.Guide");
+		manager.registerType<Guider::TextComponent>("common.Text");
+		manager.registerTypeProperties<Guider::TextComponent>("common.Text");
+
+		engine.resize(size);
+	}
+
+	bool Runner::enabled(const std::string& scenario, const std::string& operation) const
+	{
+		return options.filter.empty() || (scenario + "/" + operation).find(options.filter) != std::string::npos;
+	}
+
+	void Runner::measure(const std::string& scenario, const std::string& operation, size_t size,
+		const std::function<void()>& prepare, const std::function<void()>& op)
+	{
+		using Clock = std::chrono::steady_clock;
+
+		if (!enabled(scenario, operation))
+			return;
+
+		//warm up
+		prepare();
+		op();
+
+		std::chrono::nanoseconds total(0);
+		size_t iterations = 0;
+		const std::chrono::nanoseconds minTime(static_cast<int64_t>(options.minTime * 1e6));
+
+		while (options.iterations != 0 ? iterations < options.iterations : total < minTime)
+		{
+			prepare();
+			auto start = Clock::now();
+			op();
+			total += Clock::now() - start;
+			++iterations;
+		}
+
+		Result result;
+		result.scenario = scenario;
+		result.operation = operation;
+		result.size = size;
+		result.iterations = iterations;
+		result.nsPerOp = static_cast<double>(total.count()) / iterations;
+		results.push_back(result);
+
+		log() << std::left << std::setw(28) << scenario << std::setw(14) << operation
+			<< std::right << std::setw(10) << size << std::setw(10) << iterations
+			<< std::setw(16) << std::fixed << std::setprecision(1) << result.nsPerOp << " ns/op" << std::endl;
+	}
+
+	const std::vector<Result>& Runner::getResults() const noexcept
+	{
+		return results;
+	}
+
+	std::ostream& Runner::log() const noexcept
+	{
+		return options.jsonPath == "-" ? std::cerr : std::cout;
+	}
+
+	static std::string escapeJson(const std::string& s)
+	{
+		std::string ret;
+		ret.reserve(s.size());
+		for (char c : s)
+		{
+			if (c == '"' || c == '\\')
+				ret += '\\';
+			ret += c;
+		}
+		return ret;
+	}
+
+	void Runner::writeJson(std::ostream& out) const
+	{
+		out << "{\n\t\"benchmarks\": [";
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			const Result& r = results[i];
+			out << (i == 0 ? "\n" : ",\n");
+			out << "\t\t{ \"scenario\": \"" << escapeJson(r.scenario)
+				<< "\", \"operation\": \"" << escapeJson(r.operation)
+				<< "\", \"size\": " << r.size
+				<< ", \"iterations\": " << r.iterations
+				<< ", \"ns_per_op\": " << std::fixed << std::setprecision(1) << r.nsPerOp << " }";
+		}
+		out << "\n\t]\n}\n";
+	}
+
+	Runner::Runner(const Options& o) : options(o)
+	{
+	}
+}
\ No newline at end of file
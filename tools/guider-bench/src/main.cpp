@@ -0,0 +1,112 @@
+#include <scenarios.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+static void printUsage()
+{
+	std::cout <<
+		"Usage: guider-bench [options]\n"
+		"  --rows N[,N...]     row counts of list scenarios (default 10000)\n"
+		"  --scroll-rows N     row count of scroll scenario (default 100000)\n"
+		"  --recycler-items N  item count of recycler scenario (default 1000000)\n"
+		"  --markers N         marker count of absolute scenario (default 500)\n"
+		"  --depth N           nesting depth of deep scenario (default 100)\n"
+		"  --constraints N     chained constraints in constraints scenario (default 2000)\n"
+		"  --widgets N         widget count of dashboard scenario (default 400)\n"
+		"  --threads N         threads of parallel layout, including main one (default hardware concurrency)\n"
+		"  --iterations N      fixed number of iterations per benchmark\n"
+		"  --min-time MS       minimal measured time per benchmark (default 200)\n"
+		"  --filter TEXT       run only benchmarks which \"scenario/operation\" contains TEXT\n"
+		"  --json FILE         write results as JSON, \"-\" for standard output\n";
+}
+
+static std::vector<size_t> parseList(const std::string& s)
+{
+	std::vector<size_t> ret;
+	std::istringstream in(s);
+	std::string item;
+	while (std::getline(in, item, ','))
+		ret.push_back(std::stoull(item));
+	return ret;
+}
+
+int main(int argc, char** argv)
+{
+	Bench::Options options;
+
+	try
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			std::string arg = argv[i];
+			if (arg == "--help" || arg == "-h")
+			{
+				printUsage();
+				return 0;
+			}
+			if (i + 1 >= argc)
+				throw std::invalid_argument("missing value for " + arg);
+			std::string value = argv[++i];
+
+			if (arg == "--rows")
+				options.rows = parseList(value);
+			else if (arg == "--scroll-rows")
+				options.scrollRows = std::stoull(value);
+			else if (arg == "--recycler-items")
+				options.recyclerItems = std::stoull(value);
+			else if (arg == "--markers")
+				options.markers = std::stoull(value);
+			else if (arg == "--depth")
+				options.depth = std::stoull(value);
+			else if (arg == "--constraints")
+				options.constraints = std::stoull(value);
+			else if (arg == "--widgets")
+				options.widgets = std::stoull(value);
+			else if (arg == "--threads")
+				options.threads = std::stoull(value);
+			else if (arg == "--iterations")
+				options.iterations = std::stoull(value);
+			else if (arg == "--min-time")
+				options.minTime = std::stod(value);
+			else if (arg == "--filter")
+				options.filter = value;
+			else if (arg == "--json")
+				options.jsonPath = value;
+			else
+				throw std::invalid_argument("unknown option " + arg);
+		}
+		if (options.depth == 0 || options.constraints == 0 || options.scrollRows == 0 || options.recyclerItems == 0 || options.markers == 0 || options.widgets == 0)
+			throw std::invalid_argument("depth, constraints, scroll rows, recycler items, markers and widgets must be positive");
+		for (size_t r : options.rows)
+			if (r == 0)
+				throw std::invalid_argument("row count must be positive");
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		printUsage();
+		return 1;
+	}
+
+	Bench::Runner runner(options);
+	Bench::runAll(runner, options);
+
+	if (options.jsonPath == "-")
+	{
+		runner.writeJson(std::cout);
+	}
+	else if (!options.jsonPath.empty())
+	{
+		std::ofstream out(options.jsonPath);
+		if (!out)
+		{
+			std::cerr << "cannot open " << options.jsonPath << std::endl;
+			return 1;
+		}
+		runner.writeJson(out);
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,547 @@
+#include <scenarios.hpp>
+
+#include <guider/containers.hpp>
+#include <guider/components.hpp>
+#include <guider/shortcuts.hpp>
+#include <guider/thread_pool.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+
+namespace Bench
+{
+	using namespace Guider;
+
+	static const Vec2 screenSize(1920.f, 1080.f);
+
+	/// @brief Measures operations shared by all scenarios.
+	/// @param name Scenario name.
+	/// @param size Number of components in the tree.
+	/// @param stain Invalidates part of the tree, so next update has work to do.
+	/// @param target Component which visuals are invalidated before draw.
+	/// @param xml Layout equivalent to the tree, used to measure instantiation.
+	static void measureTree(Runner& runner, Fixture& fixture, const std::string& name, size_t size,
+		const std::function<void()>& stain, Component& target, const std::string& xml)
+	{
+		fixture.frame();
+
+		Component::resetMeasureCacheStats();
+		runner.measure(name, "update", size, stain, [&fixture]() {
+			fixture.engine.update();
+		});
+		if (runner.enabled(name, "update"))
+		{
+			runner.log() << "  measure cache: " << Component::getMeasureCacheHits() << " hits, "
+				<< Component::getMeasureCacheMisses() << " misses" << std::endl;
+		}
+
+		runner.measure(name, "draw", size, [&fixture, &target]() {
+			target.invalidateVisuals();
+			fixture.backend.getRecordingCanvas().clear();
+		}, [&fixture]() {
+			fixture.engine.draw();
+		});
+
+		size_t step = 0;
+		runner.measure(name, "handleEvent", size, []() {}, [&fixture, &step]() {
+			++step;
+			float x = static_cast<float>((step * 37) % static_cast<size_t>(screenSize.x));
+			float y = static_cast<float>((step * 53) % static_cast<size_t>(screenSize.y));
+			fixture.engine.handleEvent(Event::createMouseEvent(Event::MouseEvent::Moved, x, y, 0));
+		});
+
+		//bursts of high rate mouse input, coalesced into single dispatch
+		runner.measure(name, "postEvent", size, []() {}, [&fixture, &step]() {
+			for (size_t i = 0; i < 16; ++i)
+			{
+				++step;
+				float x = static_cast<float>((step * 37) % static_cast<size_t>(screenSize.x));
+				float y = static_cast<float>((step * 53) % static_cast<size_t>(screenSize.y));
+				fixture.engine.postEvent(Event::createMouseEvent(Event::MouseEvent::Moved, x, y, 0));
+			}
+			fixture.engine.flushEvents();
+		});
+
+		if (runner.enabled(name, "instantiate"))
+		{
+			auto root = XML::parse(xml);
+			const XML::Tag* tag = nullptr;
+			for (const auto& n : root->children)
+			{
+				if (!n->isTextNode())
+				{
+					tag = static_cast<const XML::Tag*>(n.get());
+					break;
+				}
+			}
+			if (tag != nullptr)
+			{
+				Component::Type instance;
+				runner.measure(name, "instantiate", size, [&instance]() {
+					instance.reset();
+				}, [&fixture, &instance, tag]() {
+					instance = fixture.manager.instantiate(*tag);
+				});
+			}
+		}
+
+		fixture.engine.clearChildren();
+	}
+
+	static void constrainToParent(ConstraintsContainer& parent, const Component::Type& child, float inset, bool constOffset)
+	{
+		Component::Type p = parent.shared_from_this();
+		auto h = parent.addConstraint(Orientation::Horizontal, child, constOffset);
+		h->attachBetween(p, true, p, false, inset);
+		auto v = parent.addConstraint(Orientation::Vertical, child, constOffset);
+		v->attachBetween(p, true, p, false, inset);
+	}
+
+	static std::string constrainToParentXml(bool constOffset)
+	{
+		std::string sizing = constOffset ? "const_offset" : "const_size";
+		return " horizontalConstraint=\"regular\" horizontalSizing=\"" + sizing + "\""
+			" attachLeftTo=\"parent left 1\" attachRightTo=\"parent right 1\""
+			" verticalConstraint=\"regular\" verticalSizing=\"" + sizing + "\""
+			" attachTopTo=\"parent top 1\" attachBottomTo=\"parent bottom 1\"";
+	}
+
+	void runDeepScenario(Runner& runner, const Options& options)
+	{
+		Fixture fixture(screenSize);
+
+		std::shared_ptr<ConstraintsContainer> root = std::make_shared<ConstraintsContainer>();
+		root->setSizingMode(SizingMode::MatchParent, SizingMode::MatchParent);
+		root->setBackgroundColor(Color::White);
+		fixture.engine.addChild(root);
+
+		std::shared_ptr<ConstraintsContainer> parent = root;
+		for (size_t i = 1; i < options.depth; ++i)
+		{
+			std::shared_ptr<ConstraintsContainer> c = std::make_shared<ConstraintsContainer>();
+			c->setSizingMode(SizingMode::MatchParent, SizingMode::MatchParent);
+			c->setBackgroundColor(i % 2 == 0 ? Color::White : Color::Black);
+			parent->addChild(c);
+			constrainToParent(*parent, c, 1.f, true);
+			parent = c;
+		}
+
+		std::shared_ptr<TextComponent> leaf = std::make_shared<TextComponent>();
+		leaf->setSizingMode(SizingMode::WrapContent, SizingMode::WrapContent);
+		leaf->setText("leaf");
+		parent->addChild(leaf);
+		constrainToParent(*parent, leaf, 1.f, false);
+
+		std::ostringstream xml;
+		xml << "<containers.ConstraintsContainer width=\"match_parent\" height=\"match_parent\" backgroundColor=\"#ffffff\">";
+		for (size_t i = 1; i < options.depth; ++i)
+			xml << "<containers.ConstraintsContainer width=\"match_parent\" height=\"match_parent\" backgroundColor=\"#000000\"" << constrainToParentXml(true) << ">";
+		xml << "<common.Text width=\"wrap_content\" height=\"wrap_content\" text=\"leaf\"" << constrainToParentXml(false) << "/>";
+		for (size_t i = 1; i < options.depth; ++i)
+			xml << "</containers.ConstraintsContainer>";
+		xml << "</containers.ConstraintsContainer>";
+
+		bool longText = false;
+		measureTree(runner, fixture, "deep_" + std::to_string(options.depth), options.depth + 1, [&leaf, &longText]() {
+			longText = !longText;
+			leaf->setText(longText ? "longer leaf" : "leaf");
+		}, *leaf, xml.str());
+	}
+
+	void runListScenario(Runner& runner, const Options&, size_t rows)
+	{
+		Fixture fixture(screenSize);
+
+		std::shared_ptr<ListContainer> list = std::make_shared<ListContainer>();
+		list->setSizingMode(SizingMode::MatchParent, SizingMode::MatchParent);
+		list->setOrientation(Orientation::Vertical);
+		fixture.engine.addChild(list);
+
+		std::vector<std::shared_ptr<RectangleShapeComponent>> elements;
+		elements.reserve(rows);
+		for (size_t i = 0; i < rows; ++i)
+		{
+			std::shared_ptr<RectangleShapeComponent> row = std::make_shared<RectangleShapeComponent>(200.f, 20.f, i % 2 == 0 ? Color::White : Color::Black);
+			list->addChild(row);
+			elements.push_back(row);
+		}
+
+		std::ostringstream xml;
+		xml << "<containers.ListContainer width=\"match_parent\" height=\"match_parent\" orientation=\"vertical\">";
+		for (size_t i = 0; i < rows; ++i)
+			xml << "<shapes.Rectangle width=\"200\" height=\"20\" fillColor=\"" << (i % 2 == 0 ? "#ffffff" : "#000000") << "\"/>";
+		xml << "</containers.ListContainer>";
+
+		//resizing first visible row moves every row after it
+		bool tall = false;
+		std::shared_ptr<RectangleShapeComponent> first = elements.front();
+		measureTree(runner, fixture, "list_" + std::to_string(rows), rows + 1, [&first, &tall]() {
+			tall = !tall;
+			first->setHeight(tall ? 24.f : 20.f);
+		}, *elements[std::min<size_t>(elements.size() - 1, 10)], xml.str());
+	}
+
+	void runScrollScenario(Runner& runner, const Options& options)
+	{
+		std::string name = "scroll_" + std::to_string(options.scrollRows);
+		if (!runner.enabled(name, "scroll") && !runner.enabled(name, "scroll_copy"))
+			return;
+
+		Fixture fixture(screenSize);
+
+		std::shared_ptr<ListContainer> list = std::make_shared<ListContainer>();
+		list->setSizingMode(SizingMode::MatchParent, SizingMode::MatchParent);
+		list->setOrientation(Orientation::Vertical);
+		fixture.engine.addChild(list);
+
+		for (size_t i = 0; i < options.scrollRows; ++i)
+			list->addChild(std::make_shared<RectangleShapeComponent>(200.f, 20.f, i % 2 == 0 ? Color::White : Color::Black));
+		fixture.frame();
+
+		//scrolls forth and back by a few rows, like mouse wheel does
+		float offset = 0;
+		float step = -60.f;
+		float limit = -static_cast<float>(options.scrollRows) * 20.f + screenSize.y;
+		auto prepare = [&fixture]() {
+			fixture.backend.getRecordingCanvas().clear();
+		};
+		auto scroll = [&]() {
+			offset += step;
+			if (offset < limit || offset > 0)
+			{
+				step = -step;
+				offset += 2 * step;
+			}
+			list->setOffset(offset);
+			fixture.engine.update();
+			fixture.engine.draw();
+		};
+		runner.measure(name, "scroll", options.scrollRows + 1, prepare, scroll);
+
+		//same steps, rows that stay visible are copied from previous frame
+		list->setScrollByCopy(true);
+		fixture.frame();
+		runner.measure(name, "scroll_copy", options.scrollRows + 1, prepare, scroll);
+
+		fixture.engine.clearChildren();
+	}
+
+	void runEstimatedListScenario(Runner& runner, const Options& options)
+	{
+		std::string name = "estimated_" + std::to_string(options.scrollRows);
+		if (!runner.enabled(name, "update") && !runner.enabled(name, "resize"))
+			return;
+
+		Fixture fixture(screenSize);
+
+		std::shared_ptr<ListContainer> list = std::make_shared<ListContainer>();
+		list->setSizingMode(SizingMode::MatchParent, SizingMode::WrapContent);
+		list->setOrientation(Orientation::Vertical);
+		list->setSizeEstimation(true);
+		fixture.engine.addChild(list);
+
+		std::vector<std::shared_ptr<TextComponent>> rows;
+		rows.reserve(options.scrollRows);
+		for (size_t i = 0; i < options.scrollRows; ++i)
+		{
+			std::shared_ptr<TextComponent> row = std::make_shared<TextComponent>();
+			row->setSizingMode(SizingMode::MatchParent, SizingMode::WrapContent);
+			row->setText("row " + std::to_string(i));
+			list->addChild(row);
+			rows.push_back(row);
+		}
+		fixture.frame();
+
+		//resizing visible row, only rows near viewport are measured again
+		bool large = false;
+		std::shared_ptr<TextComponent> first = rows.front();
+		runner.measure(name, "update", options.scrollRows + 1, [&]() {
+			large = !large;
+			first->setTextSize(large ? 14.f : 10.f);
+			fixture.backend.getRecordingCanvas().clear();
+		}, [&fixture]() {
+			fixture.engine.update();
+		});
+
+		//changing width invalidates every measured size
+		bool narrow = false;
+		runner.measure(name, "resize", options.scrollRows + 1, [&]() {
+			narrow = !narrow;
+			fixture.engine.resize(Vec2(narrow ? screenSize.x / 2 : screenSize.x, screenSize.y));
+			fixture.backend.getRecordingCanvas().clear();
+		}, [&fixture]() {
+			fixture.engine.update();
+		});
+
+		fixture.engine.clearChildren();
+	}
+
+	/// @brief Rows of alternating colors, every one 20 pixels high.
+	class RowAdapter : public ListAdapter
+	{
+	public:
+		size_t getItemCount() const override
+		{
+			return count;
+		}
+
+		Component::Type createView() override
+		{
+			return std::make_shared<RectangleShapeComponent>(200.f, 20.f, Color::White);
+		}
+
+		void bindView(Component& view, size_t index) override
+		{
+			view.as<RectangleShapeComponent>().setColor(index % 2 == 0 ? Color::White : Color::Black);
+		}
+
+		float estimateSize(size_t) const override
+		{
+			return 20.f;
+		}
+
+		RowAdapter(size_t count) : count(count) {}
+	private:
+		size_t count;
+	};
+
+	void runRecyclerScenario(Runner& runner, const Options& options)
+	{
+		std::string name = "recycler_" + std::to_string(options.recyclerItems);
+		if (!runner.enabled(name, "bind") && !runner.enabled(name, "scroll"))
+			return;
+
+		Fixture fixture(screenSize);
+
+		std::shared_ptr<RecyclerListContainer> list = std::make_shared<RecyclerListContainer>();
+		list->setSizingMode(SizingMode::MatchParent, SizingMode::MatchParent);
+		list->setOrientation(Orientation::Vertical);
+		fixture.engine.addChild(list);
+
+		std::shared_ptr<RowAdapter> adapter = std::make_shared<RowAdapter>(options.recyclerItems);
+
+		//setting adapter and laying out first frame, equivalent of instantiating plain list
+		runner.measure(name, "bind", options.recyclerItems, [&list]() {
+			list->setAdapter(nullptr);
+		}, [&]() {
+			list->setAdapter(adapter);
+			fixture.frame();
+		});
+		list->setAdapter(adapter);
+		fixture.frame();
+
+		float offset = 0;
+		float step = -60.f;
+		float limit = -static_cast<float>(options.recyclerItems) * 20.f + screenSize.y;
+		runner.measure(name, "scroll", options.recyclerItems, [&fixture]() {
+			fixture.backend.getRecordingCanvas().clear();
+		}, [&]() {
+			offset += step;
+			if (offset < limit || offset > 0)
+			{
+				step = -step;
+				offset += 2 * step;
+			}
+			list->setOffset(offset);
+			fixture.engine.update();
+			fixture.engine.draw();
+		});
+
+		fixture.engine.clearChildren();
+	}
+
+	void runAbsoluteScenario(Runner& runner, const Options& options)
+	{
+		std::string name = "absolute_" + std::to_string(options.markers);
+		if (!runner.enabled(name, "update"))
+			return;
+
+		Fixture fixture(screenSize);
+
+		std::shared_ptr<AbsoluteContainer> overlay = std::make_shared<AbsoluteContainer>();
+		overlay->setSizingMode(SizingMode::MatchParent, SizingMode::MatchParent);
+		fixture.engine.addChild(overlay);
+
+		std::vector<std::shared_ptr<RectangleShapeComponent>> markers;
+		markers.reserve(options.markers);
+		for (size_t i = 0; i < options.markers; ++i)
+		{
+			std::shared_ptr<RectangleShapeComponent> marker = std::make_shared<RectangleShapeComponent>(16.f, 16.f, Color::Black);
+			float x = static_cast<float>((i * 37) % static_cast<size_t>(screenSize.x - 16.f));
+			float y = static_cast<float>((i * 53) % static_cast<size_t>(screenSize.y - 16.f));
+			overlay->addChild(marker, x, y);
+			markers.push_back(marker);
+		}
+		fixture.frame();
+
+		//single marker grows and shrinks, others stay in place
+		size_t step = 0;
+		runner.measure(name, "update", options.markers + 1, [&fixture]() {
+			fixture.backend.getRecordingCanvas().clear();
+		}, [&]() {
+			++step;
+			markers[(step * 7) % markers.size()]->setSize(step % 2 == 0 ? 16.f : 24.f, 16.f);
+			fixture.engine.update();
+			fixture.engine.draw();
+		});
+
+		fixture.engine.clearChildren();
+	}
+
+	void runConstraintsScenario(Runner& runner, const Options& options)
+	{
+		Fixture fixture(screenSize);
+
+		std::shared_ptr<ConstraintsContainer> root = std::make_shared<ConstraintsContainer>();
+		root->setSizingMode(SizingMode::MatchParent, SizingMode::MatchParent);
+		fixture.engine.addChild(root);
+
+		std::vector<std::shared_ptr<RectangleShapeComponent>> elements;
+		elements.reserve(options.constraints);
+
+		std::ostringstream xml;
+		xml << "<containers.ConstraintsContainer width=\"match_parent\" height=\"match_parent\">";
+
+		Component::Type previous = root;
+		for (size_t i = 0; i < options.constraints; ++i)
+		{
+			std::shared_ptr<RectangleShapeComponent> e = std::make_shared<RectangleShapeComponent>(1.f, 20.f, Color::Black);
+			root->addChild(e);
+
+			auto h = root->addConstraint(Orientation::Horizontal, e, false);
+			h->attachLeftTo(previous, previous == root, 0.f);
+			h->attachRightTo(root, false, 0.f);
+			h->setSize(2.f); //room for element to grow
+			h->setFlow(0.f);
+			auto v = root->addConstraint(Orientation::Vertical, e, false);
+			v->attachBetween(root, true, root, false, 0.f);
+			v->setSize(20.f);
+			v->setFlow(0.f);
+
+			xml << "<shapes.Rectangle name=\"e" << i << "\" width=\"1\" height=\"20\" fillColor=\"#000000\""
+				<< " horizontalConstraint=\"regular\" horizontalSizing=\"const_size\" horizontalFlow=\"0\""
+				<< " attachLeftTo=\"" << (i == 0 ? std::string("parent left") : "e" + std::to_string(i - 1) + " right") << "\""
+				<< " attachRightTo=\"parent right\""
+				<< " verticalConstraint=\"regular\" verticalSizing=\"const_size\" verticalFlow=\"0\""
+				<< " attachTopTo=\"parent top\" attachBottomTo=\"parent bottom\"/>";
+
+			elements.push_back(e);
+			previous = e;
+		}
+		xml << "</containers.ConstraintsContainer>";
+
+		std::string name = "constraints_" + std::to_string(options.constraints);
+		bool wide = false;
+
+		//resizing tail of the chain affects nothing else
+		std::shared_ptr<RectangleShapeComponent> last = elements.back();
+		fixture.frame();
+		runner.measure(name, "update_tail", options.constraints + 1, [&last, &wide]() {
+			wide = !wide;
+			last->setWidth(wide ? 2.f : 1.f);
+		}, [&fixture]() {
+			fixture.engine.update();
+		});
+
+		//resizing head of the chain moves every element after it
+		std::shared_ptr<RectangleShapeComponent> first = elements.front();
+		measureTree(runner, fixture, name, options.constraints + 1, [&first, &wide]() {
+			wide = !wide;
+			first->setWidth(wide ? 2.f : 1.f);
+		}, *elements.back(), xml.str());
+	}
+
+	void runDashboardScenario(Runner& runner, const Options& options)
+	{
+		std::string name = "dashboard_" + std::to_string(options.widgets);
+		bool parallel = options.threads > 1;
+		if (!runner.enabled(name, "tick") && !runner.enabled(name, "resize") &&
+			!(parallel && (runner.enabled(name, "tick_pool") || runner.enabled(name, "resize_pool"))))
+			return;
+
+		Fixture fixture(screenSize);
+
+		std::shared_ptr<ConstraintsContainer> root = std::make_shared<ConstraintsContainer>();
+		root->setSizingMode(SizingMode::MatchParent, SizingMode::MatchParent);
+		fixture.engine.addChild(root);
+
+		//widgets in a grid, each constrained only to the root, so every widget is independent cluster
+		size_t columns = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(options.widgets))));
+		size_t rows = (options.widgets + columns - 1) / columns;
+		float cellWidth = screenSize.x / columns;
+		float cellHeight = screenSize.y / rows;
+
+		std::vector<std::shared_ptr<TextComponent>> values;
+		values.reserve(options.widgets);
+		for (size_t i = 0; i < options.widgets; ++i)
+		{
+			std::shared_ptr<ListContainer> widget = std::make_shared<ListContainer>();
+			widget->setSizingMode(SizingMode::MatchParent, SizingMode::WrapContent);
+			widget->setOrientation(Orientation::Vertical);
+			for (size_t j = 0; j < 8; ++j)
+			{
+				std::shared_ptr<TextComponent> row = std::make_shared<TextComponent>();
+				row->setSizingMode(SizingMode::WrapContent, SizingMode::WrapContent);
+				row->setText("metric " + std::to_string(j) + ": 0");
+				widget->addChild(row);
+				if (j == 0)
+					values.push_back(row);
+			}
+			root->addChild(widget);
+
+			auto h = root->addConstraint(Orientation::Horizontal, widget, false);
+			h->attachBetween(root, true, (i % columns) * cellWidth, root, false, 0.f);
+			h->setSize(cellWidth);
+			h->setFlow(0.f);
+			auto v = root->addConstraint(Orientation::Vertical, widget, false);
+			v->attachBetween(root, true, (i / columns) * cellHeight, root, false, 0.f);
+			v->setSize(cellHeight);
+			v->setFlow(0.f);
+		}
+		fixture.frame();
+
+		//every widget shows new value, each cluster is dirty
+		size_t step = 0;
+		auto tick = [&]() {
+			++step;
+			for (size_t i = 0; i < values.size(); ++i)
+				values[i]->setText("metric 0: " + std::to_string((step * 31 + i * 17) % 1000));
+		};
+		//window width changes, whole layout is solved
+		bool narrow = false;
+		auto resize = [&]() {
+			narrow = !narrow;
+			fixture.engine.resize(narrow ? Vec2(screenSize.x - 64.f, screenSize.y) : screenSize);
+		};
+		auto update = [&fixture]() {
+			fixture.engine.update();
+		};
+
+		runner.measure(name, "tick", options.widgets + 1, tick, update);
+		runner.measure(name, "resize", options.widgets + 1, resize, update);
+
+		if (parallel)
+		{
+			root->setThreadPool(std::make_shared<ThreadPool>(options.threads - 1));
+			runner.measure(name, "tick_pool", options.widgets + 1, tick, update);
+			runner.measure(name, "resize_pool", options.widgets + 1, resize, update);
+		}
+
+		fixture.engine.clearChildren();
+	}
+
+	void runAll(Runner& runner, const Options& options)
+	{
+		runDeepScenario(runner, options);
+		for (size_t rows : options.rows)
+			runListScenario(runner, options, rows);
+		runScrollScenario(runner, options);
+		runEstimatedListScenario(runner, options);
+		runRecyclerScenario(runner, options);
+		runAbsoluteScenario(runner, options);
+		runConstraintsScenario(runner, options);
+		runDashboardScenario(runner, options);
+	}
+}
\ No newline at end of file
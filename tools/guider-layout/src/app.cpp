@@ -167,17 +167,17 @@ void App::run()
 				}
 				case sf::Event::MouseMoved:
 				{
-					engine->handleEvent(Guider::Event::createMouseEvent(Guider::Event::MouseEvent::Subtype::Moved, static_cast<float>(event.mouseMove.x), static_cast<float>(event.mouseMove.y), 0));
+					engine->postEvent(Guider::Event::createMouseEvent(Guider::Event::MouseEvent::Subtype::Moved, static_cast<float>(e.mouseMove.x), static_cast<float>(e.mouseMove.y), 0));
 					break;
 				}
 				case sf::Event::MouseButtonPressed:
 				{
-					engine->handleEvent(Guider::Event::createMouseEvent(Guider::Event::MouseEvent::Subtype::ButtonDown, static_cast<float>(event.mouseButton.x), static_cast<float>(event.mouseButton.y), event.mouseButton.button));
+					engine->postEvent(Guider::Event::createMouseEvent(Guider::Event::MouseEvent::Subtype::ButtonDown, static_cast<float>(e.mouseButton.x), static_cast<float>(e.mouseButton.y), e.mouseButton.button));
 					break;
 				}
 				case sf::Event::MouseButtonReleased:
 				{
-					engine->handleEvent(Guider::Event::createMouseEvent(Guider::Event::MouseEvent::Subtype::ButtonUp, static_cast<float>(event.mouseButton.x), static_cast<float>(event.mouseButton.y), event.mouseButton.button));
+					engine->postEvent(Guider::Event::createMouseEvent(Guider::Event::MouseEvent::Subtype::ButtonUp, static_cast<float>(e.mouseButton.x), static_cast<float>(e.mouseButton.y), e.mouseButton.button));
 					break;
 				}
 				default:
@@ -189,6 +189,10 @@ void App::run()
 			engine->update();
 			engine->draw();
 
+			Gui::SfmlBackend& sfmlBackend = static_cast<Gui::SfmlBackend&>(*backend);
+			size_t drawCalls = sfmlBackend.getDrawCalls();
+			sfmlBackend.resetDrawCalls();
+
 			buffer->display();
 
 			if (first)
@@ -204,7 +208,7 @@ void App::run()
 			window->draw(*guiSprite);
 			window->display();
 			
-			getManager()->getElementById("time")->as<Guider::TextComponent>().setText(std::to_string(timer.getMax()) + " / " + std::to_string(timer.getAverage()));
+			getManager()->getElementById("time")->as<Guider::TextComponent>().setText(std::to_string(timer.getMax()) + " / " + std::to_string(timer.getAverage()) + " / " + std::to_string(drawCalls) + " draw calls");
 		}
 	}
 }